@@ -0,0 +1,452 @@
+#ifndef LEVELGENERATOR_ASPIF_H
+#define LEVELGENERATOR_ASPIF_H
+
+#include "clingo.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Writes a ground program in clingo's aspif format as it is grounded, so it can be replayed later by AspifReader
+/// without parsing or grounding. Only the statements the generator's programs ground to are supported.
+class AspifWriter : public Clingo::GroundProgramObserver
+{
+    public:
+        AspifWriter()
+        {
+            out << "asp 1 0 0\n";
+        }
+
+        void rule(bool choice, Clingo::AtomSpan head, Clingo::LiteralSpan body) override
+        {
+            out << "1 " << choice << ' ';
+            write_list(head);
+            out << " 0 ";
+            write_list(body);
+            out << '\n';
+        }
+
+        void weight_rule(
+                bool choice,
+                Clingo::AtomSpan head,
+                Clingo::weight_t lower_bound,
+                Clingo::WeightedLiteralSpan body
+        ) override
+        {
+            out << "1 " << choice << ' ';
+            write_list(head);
+            out << " 1 " << lower_bound << ' ';
+            write_list(body);
+            out << '\n';
+        }
+
+        void minimize(Clingo::weight_t priority, Clingo::WeightedLiteralSpan literals) override
+        {
+            out << "2 " << priority << ' ';
+            write_list(literals);
+            out << '\n';
+        }
+
+        void output_atom(Clingo::Symbol symbol, Clingo::atom_t atom) override
+        {
+            // Atom 0 marks a shown fact, which has no condition
+            out << "4 ";
+            write_name(symbol);
+            if (atom == 0)
+            {
+                out << " 0\n";
+            }
+            else
+            {
+                out << " 1 " << atom << '\n';
+            }
+        }
+
+        void external(Clingo::atom_t atom, Clingo::ExternalType type) override
+        {
+            // clingo's external types are numbered the same as in aspif
+            out << "5 " << atom << ' ' << static_cast<int>(type) << '\n';
+        }
+
+        void output_term(Clingo::Symbol, Clingo::LiteralSpan) override
+        {
+            throw std::runtime_error("aspif: shown terms are not supported");
+        }
+
+        void project(Clingo::AtomSpan atoms) override
+        {
+            unsupported(atoms, "projection");
+        }
+
+        void assume(Clingo::LiteralSpan literals) override
+        {
+            unsupported(literals, "assumptions");
+        }
+
+        void heuristic(Clingo::atom_t, Clingo::HeuristicType, int, unsigned, Clingo::LiteralSpan) override
+        {
+            throw std::runtime_error("aspif: heuristic directives are not supported");
+        }
+
+        void acyc_edge(int, int, Clingo::LiteralSpan) override
+        {
+            throw std::runtime_error("aspif: edge directives are not supported");
+        }
+
+        /// Name an atom that is not shown, e.g. an input external, so it can still be looked up by symbol once read
+        void name_atom(Clingo::Symbol symbol, Clingo::literal_t literal)
+        {
+            out << "4 ";
+            write_name(symbol);
+            out << " 1 " << literal << '\n';
+        }
+
+        /// End the program, returning everything written
+        std::string finish()
+        {
+            out << "0\n";
+            return out.str();
+        }
+
+    private:
+        std::ostringstream out;
+
+        template <typename T>
+        void write_list(Clingo::Span<T> values)
+        {
+            out << values.size();
+            for (const auto& value : values)
+            {
+                out << ' ' << value;
+            }
+        }
+
+        void write_list(Clingo::WeightedLiteralSpan literals)
+        {
+            out << literals.size();
+            for (const auto& literal : literals)
+            {
+                out << ' ' << literal.literal() << ' ' << literal.weight();
+            }
+        }
+
+        void write_name(Clingo::Symbol symbol)
+        {
+            const auto name = symbol.to_string();
+            out << name.size() << ' ' << name;
+        }
+
+        template <typename T>
+        static void unsupported(Clingo::Span<T> values, const char* what)
+        {
+            // These are reported at every step, so only fail if the program actually uses them
+            if (!values.empty())
+            {
+                throw std::runtime_error(std::string("aspif: ") + what + " are not supported");
+            }
+        }
+};
+
+/// Replays a program written by AspifWriter through a solver's backend. The backend numbers atoms afresh, and named
+/// atoms get their symbols back, so they are shown in models and can be looked up, e.g. to assign externals.
+class AspifReader
+{
+    public:
+        AspifReader(Clingo::Control& solver, const char* aspif)
+            : backend(solver.backend()), aspif(aspif)
+        {
+        }
+
+        void read()
+        {
+            // Names can come after the atoms they name, so the text is scanned once, reading the names and keeping
+            // the numbers of every other statement, then those are added once all the names are known
+            scan();
+            for (const auto& statement : statements)
+            {
+                Fields fields(values, statement.begin, statement.end);
+                switch (statement.type)
+                {
+                    case 1:
+                        read_rule(fields);
+                        break;
+                    case 2:
+                        read_minimize(fields);
+                        break;
+                    case 5:
+                        read_external(fields);
+                        break;
+                    default:
+                        break;  // Only the statements above are kept by scan()
+                }
+                fields.expect_end();
+            }
+
+            for (const auto& fact : facts)
+            {
+                const auto atom = backend.add_atom(fact);
+                backend.rule(false, {atom}, {});
+            }
+
+            // Further names for an atom that was already named are equivalent to it
+            for (const auto& alias : aliases)
+            {
+                const auto atom = backend.add_atom(alias.first);
+                backend.rule(false, {atom}, {literal(alias.second)});
+            }
+        }
+
+    private:
+        /// A statement kept by scan(), as its type and the range of its numbers in values
+        struct Statement
+        {
+            int type;
+            size_t begin;
+            size_t end;
+        };
+
+        /// Reads the numbers of one kept statement in turn
+        class Fields
+        {
+            public:
+                Fields(const std::vector<int64_t>& values, size_t begin, size_t end)
+                    : values(values), pos(begin), end(end) {}
+
+                template <typename T>
+                T next()
+                {
+                    if (pos == end)
+                    {
+                        throw std::runtime_error("aspif: malformed statement");
+                    }
+                    return static_cast<T>(values[pos++]);
+                }
+
+                /// The length of a list, which can be no longer than the numbers left
+                size_t next_size()
+                {
+                    const auto size = next<int64_t>();
+                    if (size < 0 || static_cast<size_t>(size) > end - pos)
+                    {
+                        throw std::runtime_error("aspif: malformed statement");
+                    }
+                    return static_cast<size_t>(size);
+                }
+
+                void expect_end() const
+                {
+                    if (pos != end)
+                    {
+                        throw std::runtime_error("aspif: malformed statement");
+                    }
+                }
+
+            private:
+                const std::vector<int64_t>& values;
+                size_t pos;
+                const size_t end;
+        };
+
+        Clingo::Backend backend;
+        const char* aspif;
+
+        std::vector<int64_t> values;  // The numbers of every kept statement, in order
+        std::vector<Statement> statements;
+        std::unordered_map<Clingo::atom_t, Clingo::Symbol> names;  // By atom in the aspif
+        std::unordered_map<Clingo::atom_t, Clingo::atom_t> atoms;  // From the aspif to the backend
+        std::vector<Clingo::Symbol> facts;
+        std::vector<std::pair<Clingo::Symbol, Clingo::literal_t>> aliases;
+
+        /// Read the names, and keep the numbers of every other statement, parsing the text in place
+        void scan()
+        {
+            const char* pos = aspif;
+            if (std::strncmp(pos, "asp 1 ", 6) != 0)
+            {
+                throw std::runtime_error("aspif: unsupported header");
+            }
+            pos = std::strchr(pos, '\n');
+
+            while (pos && *pos == '\n' && *++pos != '\0')
+            {
+                const auto type = next_number(pos);
+                if (type == 0)
+                {
+                    return;
+                }
+
+                if (type == 4)
+                {
+                    read_name(pos);
+                }
+                else if (type == 1 || type == 2 || type == 5)
+                {
+                    const auto begin = values.size();
+                    while (*skip_spaces(pos) != '\n' && *pos != '\0')
+                    {
+                        values.push_back(next_number(pos));
+                    }
+                    statements.push_back({static_cast<int>(type), begin, values.size()});
+                }
+                else
+                {
+                    throw std::runtime_error("aspif: unsupported statement " + std::to_string(type));
+                }
+
+                if (*skip_spaces(pos) != '\n')
+                {
+                    break;
+                }
+            }
+            throw std::runtime_error("aspif: unexpected end of program");
+        }
+
+        static const char* skip_spaces(const char*& pos)
+        {
+            while (*pos == ' ')
+            {
+                ++pos;
+            }
+            return pos;
+        }
+
+        static int64_t next_number(const char*& pos)
+        {
+            char* end = nullptr;
+            const auto value = std::strtoll(skip_spaces(pos), &end, 10);
+            if (end == pos)
+            {
+                throw std::runtime_error("aspif: malformed statement");
+            }
+            pos = end;
+            return value;
+        }
+
+        Clingo::atom_t atom(Clingo::atom_t aspif_atom)
+        {
+            const auto found = atoms.find(aspif_atom);
+            if (found != atoms.end())
+            {
+                return found->second;
+            }
+
+            const auto name = names.find(aspif_atom);
+            const auto added = name != names.end() ? backend.add_atom(name->second) : backend.add_atom();
+            atoms.emplace(aspif_atom, added);
+            return added;
+        }
+
+        Clingo::literal_t literal(Clingo::literal_t aspif_literal)
+        {
+            const auto added = static_cast<Clingo::literal_t>(atom(static_cast<Clingo::atom_t>(std::abs(aspif_literal))));
+            return aspif_literal < 0 ? -added : added;
+        }
+
+        std::vector<Clingo::atom_t> read_atoms(Fields& fields)
+        {
+            std::vector<Clingo::atom_t> result(fields.next_size());
+            for (auto& value : result)
+            {
+                value = atom(fields.next<Clingo::atom_t>());
+            }
+            return result;
+        }
+
+        std::vector<Clingo::literal_t> read_literals(Fields& fields)
+        {
+            std::vector<Clingo::literal_t> result(fields.next_size());
+            for (auto& value : result)
+            {
+                value = literal(fields.next<Clingo::literal_t>());
+            }
+            return result;
+        }
+
+        std::vector<Clingo::WeightedLiteral> read_weighted_literals(Fields& fields)
+        {
+            std::vector<Clingo::WeightedLiteral> result;
+            const auto size = fields.next_size();
+            result.reserve(size);
+            for (auto i = 0U; i < size; ++i)
+            {
+                const auto lit = literal(fields.next<Clingo::literal_t>());
+                result.emplace_back(lit, fields.next<Clingo::weight_t>());
+            }
+            return result;
+        }
+
+        void read_name(const char*& pos)
+        {
+            const auto length = next_number(pos);
+            if (length < 0 || *pos != ' ')
+            {
+                throw std::runtime_error("aspif: malformed name");
+            }
+            ++pos;  // The space before the name
+            const auto name_length = static_cast<size_t>(length);
+            if (std::memchr(pos, '\0', name_length))
+            {
+                throw std::runtime_error("aspif: malformed name");
+            }
+            const std::string name(pos, name_length);
+            pos += name_length;
+            const auto symbol = Clingo::parse_term(name.c_str());
+
+            const auto num_literals = next_number(pos);
+            if (num_literals == 0)
+            {
+                facts.push_back(symbol);
+                return;
+            }
+
+            const auto condition = static_cast<Clingo::literal_t>(next_number(pos));
+            if (num_literals > 1 || condition < 0)
+            {
+                throw std::runtime_error("aspif: only atoms can be named");
+            }
+
+            const auto aspif_atom = static_cast<Clingo::atom_t>(condition);
+            if (!names.emplace(aspif_atom, symbol).second)
+            {
+                aliases.emplace_back(symbol, condition);
+            }
+        }
+
+        void read_rule(Fields& fields)
+        {
+            const auto choice = fields.next<int>() != 0;
+            const auto head = read_atoms(fields);
+            if (fields.next<int>() == 0)
+            {
+                const auto body = read_literals(fields);
+                backend.rule(choice, head, body);
+            }
+            else
+            {
+                const auto lower_bound = fields.next<Clingo::weight_t>();
+                const auto body = read_weighted_literals(fields);
+                backend.weight_rule(choice, head, lower_bound, body);
+            }
+        }
+
+        void read_minimize(Fields& fields)
+        {
+            const auto priority = fields.next<Clingo::weight_t>();
+            const auto literals = read_weighted_literals(fields);
+            backend.minimize(priority, literals);
+        }
+
+        void read_external(Fields& fields)
+        {
+            const auto external_atom = atom(fields.next<Clingo::atom_t>());
+            backend.external(external_atom, static_cast<Clingo::ExternalType>(fields.next<int>()));
+        }
+};
+
+#endif //LEVELGENERATOR_ASPIF_H
@@ -0,0 +1,134 @@
+#include "bench.h"
+#include "level_gen.h"
+#include "clingo.hh"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    Clingo::Symbol fn(const char* name, std::initializer_list<unsigned> args)
+    {
+        std::vector<Clingo::Symbol> sym_args;
+        for (const auto arg : args)
+        {
+            sym_args.push_back(Clingo::Number(static_cast<int>(arg)));
+        }
+        return Clingo::Function(name, sym_args);
+    }
+
+    /// Build the symbols for a synthetic model of the given size, with the same symbol types, and roughly the same
+    /// number of symbols, as a real one. Models this large can't be solved in reasonable time, so can't be benchmarked
+    /// from real solver output.
+    std::vector<uint64_t> synthetic_model(unsigned width, unsigned height)
+    {
+        std::vector<Clingo::Symbol> syms;
+
+        // Space around the edges, hull inside that, and ship squares elsewhere
+        for (auto y = 1U; y <= height; ++y)
+        {
+            for (auto x = 1U; x <= width; ++x)
+            {
+                const auto edge_dist = std::min(std::min(x - 1, width - x), std::min(y - 1, height - y));
+                syms.push_back(fn(edge_dist == 0 ? "in_space" : edge_dist == 1 ? "hull" : "ship", {x, y}));
+            }
+        }
+
+        // A lattice of 3x3 rooms, separated by rows and columns of corridors, each room connected to the corridor on
+        // its right
+        std::vector<std::pair<unsigned, unsigned>> rooms;
+        for (auto y = 3U; y + 3 <= height - 2; y += 4)
+        {
+            for (auto x = 3U; x + 3 <= width - 2; x += 4)
+            {
+                syms.push_back(fn("room", {x, y, 3, 3}));
+                for (auto sy = y; sy < y + 3; ++sy)
+                {
+                    for (auto sx = x; sx < x + 3; ++sx)
+                    {
+                        syms.push_back(fn("room_square", {sx, sy, x, y, 3, 3}));
+                    }
+                }
+
+                const auto cx = x + 3;
+                for (auto cy = y; cy < y + 4; ++cy)
+                {
+                    syms.push_back(fn("corridor", {cx, cy}));
+                    syms.push_back(fn("room", {cx, cy, 1, 1}));
+                    syms.push_back(fn("room_square", {cx, cy, cx, cy, 1, 1}));
+                    if (cy > y)
+                    {
+                        syms.push_back(fn("connected", {cx, cy - 1, cx, cy}));
+                    }
+                }
+                syms.push_back(fn("connected", {x, y, cx, y}));
+                rooms.emplace_back(x, y);
+            }
+        }
+
+        // A breach from the top into the first room, and a portal between the first and last rooms
+        const auto first = rooms.front();
+        const auto last = rooms.back();
+        syms.push_back(fn("alien_breach", {first.first, 1, 1, 2, first.first, first.second}));
+        syms.push_back(fn("breach_square", {first.first, 1, first.first, 1, 1, 2}));
+        syms.push_back(fn("breach_square", {first.first, 2, first.first, 1, 1, 2}));
+        syms.push_back(fn("portal", {first.first, first.second, last.first, last.second}));
+        syms.push_back(fn("start_room", {first.first, first.second}));
+        syms.push_back(fn("finish_room", {last.first, last.second}));
+
+        std::vector<uint64_t> model;
+        model.reserve(syms.size());
+        for (const auto& sym : syms)
+        {
+            model.push_back(sym.to_c());
+        }
+        return model;
+    }
+}
+
+std::vector<bench::Record> bench::bench_decode()
+{
+    using clock = std::chrono::steady_clock;
+
+    std::vector<Record> records;
+    std::cerr << "Level decode time per model" << std::endl;
+    for (const auto size : {16U, 32U, 64U})
+    {
+        const auto model = synthetic_model(size, size);
+
+        // Repeat until enough time has passed for a stable average
+        auto iterations = 0UL;
+        auto rooms = 0UL;
+        auto bytes = 0UL;
+        const auto start = clock::now();
+        auto elapsed = clock::duration::zero();
+        while (elapsed < std::chrono::milliseconds(500))
+        {
+            const Level level{size, size, 0, model};
+            rooms += level.get_num_rooms();  // Use the level, so it can't be optimised away
+            bytes += level.get_memory_size();
+            ++iterations;
+            elapsed = clock::now() - start;
+        }
+
+        const auto micros = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+        std::cerr << std::setw(2) << size << "x" << std::setw(2) << std::left << size << std::right
+                  << "  symbols: " << std::setw(6) << model.size()
+                  << "  rooms: " << std::setw(5) << rooms / iterations
+                  << "  level bytes: " << std::setw(6) << bytes / iterations
+                  << "  decode: " << std::fixed << std::setprecision(1) << micros << " us" << std::endl;
+
+        records.emplace_back();
+        records.back()
+            .add("width", size)
+            .add("height", size)
+            .add("symbols", model.size())
+            .add("rooms", rooms / iterations)
+            .add("level_bytes", bytes / iterations)
+            .add("decode_us", micros);
+    }
+
+    return records;
+}
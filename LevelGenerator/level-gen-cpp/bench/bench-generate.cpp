@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "level_gen.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    struct GridParams
+    {
+        unsigned width;
+        unsigned height;
+        unsigned min_rooms;
+        unsigned max_rooms;
+        unsigned num_breaches;
+        unsigned num_portals;
+    };
+
+    /// The same grid swept by tests/test-fuzz.cpp
+    std::vector<GridParams> fuzz_grid()
+    {
+        std::vector<GridParams> grid;
+        for (auto width = 10U; width < 16U; width += 2)
+        {
+            for (auto height = 10U; height < 14U; height += 2)
+            {
+                for (auto min_rooms = 3U; min_rooms < 5U; ++min_rooms)
+                {
+                    for (auto max_rooms = 8U; max_rooms < 16U; max_rooms += 4)
+                    {
+                        grid.push_back({width, height, min_rooms, max_rooms, 1, 1});
+                    }
+                }
+            }
+        }
+        return grid;
+    }
+}
+
+std::vector<bench::Record> bench::bench_generate(const std::vector<size_t>& seeds, double timeout_s)
+{
+    std::vector<Record> records;
+    std::cerr << "Level generation phase times (s)" << std::endl;
+    for (const auto& params : fuzz_grid())
+    {
+        for (const auto seed : seeds)
+        {
+            // A new generator each time, so adding and grounding the program is timed too. Enumerate every model,
+            // so the solver runs until it proves the optimum, or times out.
+            LevelGenerator gen{
+                    0, params.width, params.height, params.min_rooms, params.max_rooms, params.num_breaches,
+                    params.num_portals, seed
+            };
+
+            // Grounding cannot be cut short, so ground with an empty budget first, and only time out the search
+            gen.solve_for(0U);
+            const auto ground_stats = gen.get_stats();
+            gen.solve_for(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::duration<double>(timeout_s)));
+
+            const auto stats = gen.get_stats();
+            const auto* best = gen.best_level();
+
+            std::cerr << std::setw(2) << params.width << "x" << std::setw(2) << std::left << params.height
+                      << std::right << "  rooms: " << params.min_rooms << "-" << std::setw(2) << std::left
+                      << params.max_rooms << std::right << "  seed: " << std::setw(5) << seed
+                      << std::fixed << std::setprecision(3)
+                      << "  add: " << ground_stats.parse_time
+                      << "  ground: " << ground_stats.ground_time
+                      << "  first: " << stats.first_model_time
+                      << "  optimum: ";
+            if (stats.optimality_proven)
+            {
+                std::cerr << stats.best_model_time;
+            }
+            else
+            {
+                std::cerr << "timeout";
+            }
+            std::cerr << "  decode: " << stats.decode_time << std::endl;
+
+            records.emplace_back();
+            auto& record = records.back();
+            record.add("width", params.width)
+                .add("height", params.height)
+                .add("min_rooms", params.min_rooms)
+                .add("max_rooms", params.max_rooms)
+                .add("num_breaches", params.num_breaches)
+                .add("num_portals", params.num_portals)
+                .add("seed", seed)
+                .add("add_s", ground_stats.parse_time)
+                .add("ground_s", ground_stats.ground_time);
+            if (best)
+            {
+                record.add("first_model_s", stats.first_model_time);
+            }
+            else
+            {
+                record.add_null("first_model_s");
+            }
+            if (stats.optimality_proven)
+            {
+                record.add("optimum_s", stats.best_model_time);
+            }
+            else
+            {
+                record.add_null("optimum_s");
+            }
+            record.add("solve_s", stats.solve_time)
+                .add("decode_s", stats.decode_time)
+                .add("optimality_proven", stats.optimality_proven)
+                .add("models", stats.num_models)
+                .add("atoms", stats.num_atoms)
+                .add("rules", stats.num_rules)
+                .add("choices", stats.num_choices)
+                .add("conflicts", stats.num_conflicts);
+            if (best)
+            {
+                record.add("cost", best->get_cost());
+            }
+            else
+            {
+                record.add_null("cost");
+            }
+        }
+    }
+
+    return records;
+}
@@ -0,0 +1,101 @@
+#include "bench.h"
+#include "aspif.h"
+#include "program.h"
+#include "ship_geometry.h"
+#include "clingo.hh"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    /// Add and ground the embedded program for a grid size, as LevelGenerator does when it is not pregrounded
+    void ground(Clingo::Control& solver, unsigned width, unsigned height)
+    {
+        std::ostringstream program;
+        program << ship_prog << std::endl << connections_prog << std::endl
+                << "#const width = " << width << "." << std::endl
+                << "#const height = " << height << "." << std::endl;
+        solver.add("base", {}, program.str().c_str());
+        solver.add("base", {}, ShipGeometry(width, height).facts().c_str());
+        solver.ground({{"base", {}}});
+    }
+
+    /// Ground the program while recording it as aspif, as level-gen-preground does at build time
+    std::string preground(unsigned width, unsigned height)
+    {
+        AspifWriter writer;
+        Clingo::Control solver;
+        solver.register_observer(writer);
+        ground(solver, width, height);
+
+        const auto atoms = solver.symbolic_atoms();
+        for (const auto* input : {"min_rooms", "max_rooms", "num_breaches", "num_portals"})
+        {
+            for (auto it = atoms.begin(Clingo::Signature(input, 1)); it != atoms.end(); ++it)
+            {
+                writer.name_atom(it->symbol(), it->literal());
+            }
+        }
+        return writer.finish();
+    }
+
+    /// Average seconds to load the program into a fresh solver, repeating until enough time has passed for a stable
+    /// average
+    template<typename F>
+    double time_load(F&& load)
+    {
+        auto iterations = 0UL;
+        auto elapsed = clock::duration::zero();
+        while (iterations < 3 || elapsed < std::chrono::seconds(1))
+        {
+            Clingo::Control solver;
+            const auto start = clock::now();
+            load(solver);
+            elapsed += clock::now() - start;
+            ++iterations;
+        }
+        return std::chrono::duration<double>(elapsed).count() / iterations;
+    }
+}
+
+std::vector<bench::Record> bench::bench_ground()
+{
+    struct Size
+    {
+        unsigned width;
+        unsigned height;
+    };
+
+    std::vector<Record> records;
+    std::cerr << "Program load time, grounding vs reading the pregrounded aspif (ms)" << std::endl;
+    for (const auto& size : {Size{10, 10}, Size{16, 16}, Size{24, 16}, Size{32, 24}})
+    {
+        const auto aspif = preground(size.width, size.height);
+        const auto ground_s = time_load([&](Clingo::Control& solver) { ground(solver, size.width, size.height); });
+        const auto read_s = time_load([&](Clingo::Control& solver) { AspifReader(solver, aspif.c_str()).read(); });
+
+        std::cerr << std::setw(2) << size.width << "x" << std::setw(2) << std::left << size.height << std::right
+                  << "  aspif bytes: " << std::setw(9) << aspif.size()
+                  << std::fixed << std::setprecision(1)
+                  << "  ground: " << std::setw(8) << ground_s * 1000.0
+                  << "  pregrounded: " << std::setw(8) << read_s * 1000.0
+                  << std::setprecision(2) << "  speedup: " << ground_s / read_s << "x" << std::endl;
+
+        records.emplace_back();
+        records.back()
+            .add("width", size.width)
+            .add("height", size.height)
+            .add("aspif_bytes", aspif.size())
+            .add("ground_s", ground_s)
+            .add("pregrounded_s", read_s);
+    }
+
+    return records;
+}
@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void print_usage()
+    {
+        std::cerr << "Usage: level-gen-cpp-bench [options]" << std::endl
+                  << "  --out <path>      Write the JSON results to a file, rather than stdout" << std::endl
+                  << "  --timeout <s>     Stop each search after this many seconds, after grounding (default 10)" << std::endl
+                  << "  --no-decode       Skip the decode benchmark" << std::endl
+                  << "  --no-ground       Skip the grounding vs pregrounding benchmark" << std::endl
+                  << "  --no-generate     Skip the generation benchmark" << std::endl;
+    }
+
+    void write_records(std::ostream& out, const char* name, const std::vector<bench::Record>& records, bool last)
+    {
+        out << "  \"" << name << "\": [";
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            out << (i == 0 ? "\n" : ",\n") << "    " << records[i].str();
+        }
+        out << (records.empty() ? "]" : "\n  ]") << (last ? "\n" : ",\n");
+    }
+}
+
+/// Benchmarks each phase of level generation, printing progress to stderr and results as JSON, for tracking
+/// performance across versions
+int main(int argc, char** argv)
+{
+    const char* out_path = nullptr;
+    auto timeout_s = 10.0;
+    auto run_decode = true;
+    auto run_ground = true;
+    auto run_generate = true;
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            out_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+        {
+            timeout_s = std::stod(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--no-decode") == 0)
+        {
+            run_decode = false;
+        }
+        else if (std::strcmp(argv[i], "--no-ground") == 0)
+        {
+            run_ground = false;
+        }
+        else if (std::strcmp(argv[i], "--no-generate") == 0)
+        {
+            run_generate = false;
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    // Fixed seeds, so results are comparable between runs
+    const std::vector<size_t> seeds{1, 42, 1234};
+
+    const auto decode = run_decode ? bench::bench_decode() : std::vector<bench::Record>{};
+    const auto ground = run_ground ? bench::bench_ground() : std::vector<bench::Record>{};
+    const auto generate = run_generate ? bench::bench_generate(seeds, timeout_s) : std::vector<bench::Record>{};
+
+    std::ofstream file;
+    if (out_path)
+    {
+        file.open(out_path);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open " << out_path << std::endl;
+            return 1;
+        }
+    }
+    auto& out = out_path ? static_cast<std::ostream&>(file) : std::cout;
+
+    out << "{" << std::endl;
+    write_records(out, "decode", decode, false);
+    write_records(out, "ground", ground, false);
+    write_records(out, "generate", generate, true);
+    out << "}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef LEVEL_GEN_BENCH_H
+#define LEVEL_GEN_BENCH_H
+
+#include "level_gen.h"
+
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+    /// A flat JSON object of benchmark results, kept dependency-free so results can be tracked across versions
+    class Record
+    {
+        public:
+            template<class T>
+            Record& add(const char* key, T value)
+            {
+                std::ostringstream stream;
+                stream << std::setprecision(9) << value;
+                fields.emplace_back(key, stream.str());
+                return *this;
+            }
+
+            Record& add(const char* key, bool value)
+            {
+                fields.emplace_back(key, value ? "true" : "false");
+                return *this;
+            }
+
+            Record& add_null(const char* key)
+            {
+                fields.emplace_back(key, "null");
+                return *this;
+            }
+
+            std::string str() const
+            {
+                std::ostringstream stream;
+                stream << "{";
+                for (size_t i = 0; i < fields.size(); ++i)
+                {
+                    stream << (i == 0 ? "" : ", ") << "\"" << fields[i].first << "\": " << fields[i].second;
+                }
+                stream << "}";
+                return stream.str();
+            }
+
+        private:
+            std::vector<std::pair<std::string, std::string>> fields;
+    };
+
+    /// Time decoding synthetic models of increasing size into levels
+    std::vector<Record> bench_decode();
+
+    /// Time each phase of generating levels over the same parameter grid as the fuzz test, stopping each search after
+    /// timeout_s seconds if the optimum has not been proven by then. Grounding is timed separately, and not limited.
+    std::vector<Record> bench_generate(const std::vector<size_t>& seeds, double timeout_s);
+
+    /// Time loading the program into a solver for a few grid sizes, by grounding it and by reading the pregrounded
+    /// aspif, to check that pregrounding at build time is worth it
+    std::vector<Record> bench_ground();
+}
+
+#endif // LEVEL_GEN_BENCH_H
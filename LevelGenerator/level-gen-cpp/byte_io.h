@@ -0,0 +1,98 @@
+#ifndef LEVELGENERATOR_BYTE_IO_H
+#define LEVELGENERATOR_BYTE_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/// Appends integers to a byte buffer in little-endian order, so serialized data is the same on every platform
+class ByteWriter
+{
+    public:
+        explicit ByteWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        template <class T>
+        void write(T value)
+        {
+            static_assert(std::is_integral<T>::value, "only integers can be written");
+            const auto bits = static_cast<uint64_t>(value);
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+            }
+        }
+
+        void write_bytes(const uint8_t* data, size_t size)
+        {
+            out.insert(out.end(), data, data + size);
+        }
+
+        size_t position() const
+        {
+            return out.size();
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+};
+
+/// Reads little-endian integers written by ByteWriter, throwing if the data runs out
+class ByteReader
+{
+    public:
+        ByteReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        template <class T>
+        T read()
+        {
+            static_assert(std::is_integral<T>::value, "only integers can be read");
+            check_remaining(sizeof(T));
+            uint64_t bits = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                bits |= static_cast<uint64_t>(data[pos + i]) << (8 * i);
+            }
+            pos += sizeof(T);
+            return static_cast<T>(bits);
+        }
+
+        /// Get a pointer to the next `count` bytes, without copying them
+        const uint8_t* read_bytes(size_t count)
+        {
+            check_remaining(count);
+            const auto* ret = data + pos;
+            pos += count;
+            return ret;
+        }
+
+        void expect_magic(const char* magic)
+        {
+            const auto len = std::strlen(magic);
+            if (std::memcmp(read_bytes(len), magic, len) != 0)
+            {
+                throw std::runtime_error(std::string("invalid data: expected ") + magic);
+            }
+        }
+
+        size_t remaining() const
+        {
+            return size - pos;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t pos = 0;
+
+        void check_remaining(size_t count) const
+        {
+            if (count > size - pos)
+            {
+                throw std::runtime_error("invalid data: unexpected end of data");
+            }
+        }
+};
+
+#endif //LEVELGENERATOR_BYTE_IO_H
@@ -16,11 +16,15 @@
 #define CS_FLAGS
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 #include <functional>
+#include <limits>
+#include <map>
 
 /// Types of map squares
 /// These numbers are in precedence order, i.e. where a position has more than one type, the higher-numbered type takes
@@ -89,7 +93,8 @@ struct LEVEL_GEN_API MapSquare {
         MapSquare(unsigned x, unsigned y, SquareType type) : x(x), y(y), type(type) {}
 };
 
-/// Template for creating a C#-style IEnumerator over a type of level part
+/// Template for creating a C#-style IEnumerator over a type of level part. The parts are expanded from the level's
+/// packed data when the iterator is created, and shared between copies of it, so it stays valid after the level is gone.
 template<class T>
 struct LevelPartIter
 {
@@ -120,7 +125,16 @@ struct LevelPartIter
             return parts->size();
         }
 
-        explicit CS_IGNORE LevelPartIter(PartVec* parts) : parts(parts) {}
+        /// Copy up to `capacity` parts into `out`, returning the number copied, so a whole collection can be retrieved
+        /// in a single call. This does not affect the iteration position.
+        size_t copy_to(T* out, size_t capacity) const
+        {
+            const auto num = std::min(capacity, count());
+            std::copy_n(parts->cbegin(), num, out);
+            return num;
+        }
+
+        explicit CS_IGNORE LevelPartIter(std::shared_ptr<const PartVec> parts) : parts(std::move(parts)) {}
         CS_IGNORE LevelPartIter(LevelPartIter&& other) noexcept = default;
         CS_IGNORE LevelPartIter& operator=(LevelPartIter&& other) = default;
         CS_IGNORE LevelPartIter(const LevelPartIter& other) = default;
@@ -128,7 +142,7 @@ struct LevelPartIter
 
     private:
         CS_IGNORE intmax_t pos = -1;
-        CS_IGNORE PartVec* parts;
+        CS_IGNORE std::shared_ptr<const PartVec> parts;
 };
 
 // Explicit instantiations for export in the API
@@ -148,7 +162,7 @@ class LEVEL_GEN_API Level {
     public:
         // Note - to avoid exposing clingo in the header here, we use a vector of clingo's numeric symbol representation,
         // rather than a more specific type
-        CS_IGNORE Level(unsigned width, unsigned height, int64_t cost, const std::vector<uint64_t>& data);
+        CS_IGNORE Level(unsigned width, unsigned height, int64_t cost, std::vector<uint64_t> data);
 
         CS_IGNORE Level(Level && other) noexcept;
         CS_IGNORE Level& operator=(Level && other) = delete;
@@ -163,6 +177,12 @@ class LEVEL_GEN_API Level {
 
         LevelPartIter<MapSquare> map_squares() const;
 
+        /// Get the map squares as a contiguous grid, for copying in bulk. This has one byte per square, holding the
+        /// SquareType value, in row-major order, i.e. the square at one-indexed (x, y) is at index
+        /// (y - 1) * width + (x - 1). Squares with no type are zero.
+        /// Note this pointer is only valid for the lifetime of the level.
+        const uint8_t* grid_squares() const;
+
         LevelPartIter<Room> rooms() const;
 
         LevelPartIter<Door> doors() const;
@@ -185,13 +205,180 @@ class LEVEL_GEN_API Level {
 
         size_t get_num_portals() const;
 
+        /// Get the level as text, in the form of the model atoms it was decoded from, e.g. for debugging. This is
+        /// rebuilt on demand from the level's parts, so is not the solver's model: only the highest precedence type of
+        /// each square is listed, and only the atoms that make up the level. Use LevelGenerator::set_dump_models() for
+        /// the models themselves.
+        /// Note this pointer is only valid for the lifetime of the level.
+        const char* get_level_text() const;
+
+        /// Get the approximate number of bytes the level takes in memory, e.g. to size pools of kept levels
+        CS_IGNORE size_t get_memory_size() const;
+
+        /// Serialize the level to a compact, versioned binary format, which can be read back with deserialize()
+        CS_IGNORE std::vector<uint8_t> serialize() const;
+
+        /// Read a level written by serialize(), throwing if the data is invalid or from an unsupported version
+        CS_IGNORE static std::unique_ptr<Level> deserialize(const uint8_t* data, size_t size);
+
     private:
         CS_IGNORE class LevelImpl;  // Internal implementation class
         CS_IGNORE std::unique_ptr<LevelImpl> impl;
+
+        CS_IGNORE explicit Level(std::unique_ptr<LevelImpl> impl);
+};
+
+/// A read-only pack of pre-generated levels, e.g. curated levels shipped with the game. Packs opened from a file are
+/// memory-mapped, so levels are read straight from the mapping, rather than loading the whole file up front.
+class LEVEL_GEN_API LevelPack {
+    public:
+        /// Open a pack file, throwing if it cannot be mapped or is not a valid pack
+        explicit LevelPack(const char* path);
+
+        /// Use a pack that is already in memory - note the data must outlive the pack
+        CS_IGNORE LevelPack(const uint8_t* data, size_t size);
+
+        virtual ~LevelPack();
+
+        CS_IGNORE LevelPack(LevelPack&& other) noexcept;
+        CS_IGNORE LevelPack& operator=(LevelPack && other) noexcept;
+        CS_IGNORE LevelPack(const LevelPack& other) = delete;
+        CS_IGNORE LevelPack& operator=(const LevelPack& other) = delete;
+
+        size_t get_num_levels() const;
+
+        /// Load a level from the pack, throwing if the index is out of range or the level is invalid.
+        /// Note the returned pointer is only valid until the next load, or the pack is destroyed.
+        Level* load_level(size_t index);
+
+        /// Read a level from the pack, throwing if the index is out of range or the level is invalid
+        CS_IGNORE std::unique_ptr<Level> read_level(size_t index) const;
+
+        /// Write levels to a new pack file, throwing on failure
+        CS_IGNORE static void write(const char* path, const std::vector<const Level*>& levels);
+
+    private:
+        CS_IGNORE class LevelPackImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<LevelPackImpl> impl;
 };
 
 using cancel_cb = bool(*)();
 
+/// A thread-safe way to cancel a solve from another thread, e.g. when the player quits to the menu. Unlike a
+/// cancel_cb, which is only checked as levels are found, cancelling a token interrupts the search straight away, and
+/// also stops a solve before it starts searching. Note clingo cannot interrupt grounding itself, so cancelling during
+/// grounding, on the first solve, takes effect as soon as grounding finishes.
+class LEVEL_GEN_API CancelToken {
+    public:
+        CancelToken();
+
+        virtual ~CancelToken();
+
+        CS_IGNORE CancelToken(const CancelToken& other) = delete;
+        CS_IGNORE CancelToken& operator=(const CancelToken& other) = delete;
+
+        /// Cancel every solve using this token, now and until it is reset
+        void cancel();
+
+        bool is_cancelled() const;
+
+        /// Clear the token, so it can be used for another solve
+        void reset();
+
+    private:
+        CS_IGNORE class CancelTokenImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<CancelTokenImpl> impl;
+
+        friend class LevelGenerator;
+};
+
+/// Called with each level as it is found, with its cost and zero-based index in the order found
+using level_cb = void(*)(const Level& level, int cost, size_t index);
+
+/// Clingo configuration keys and values, e.g. {"solver.heuristic", "Vsids,94"}
+using ConfigMap = std::map<std::string, std::string>;
+
+/// How the solver threads share the work when solving with more than one thread
+enum class ParallelMode : uint8_t
+{
+    Split,  // Threads split the search space between them, all using the same tuned configuration
+    Compete  // Threads race each other on the whole problem, each using a different configuration from a portfolio
+};
+
+/// When the solver stops searching for better levels
+enum class OptMode : uint8_t
+{
+    Improve,  // Report each improving level, up to the generator's max_num_levels - the default
+    FirstFeasible,  // Stop at the first level found, whatever its cost
+    CostBound,  // Stop at the first level costing at most a threshold, finding none if no level is cheap enough
+    ProveOptimal,  // Keep improving until the best level is proven optimal, however many levels that takes
+    EnumerateOptimal  // Prove the optimum, then report only optimal levels, up to the generator's max_num_levels
+};
+
+/// Statistics from the last call to LevelGenerator::solve(), with times as wall times in seconds
+struct LEVEL_GEN_API GenStats {
+        double parse_time = 0.0;  // Only paid by the first solve, as the program is reused after that
+        double ground_time = 0.0;  // Only paid by the first solve, as the program is reused after that
+        double solve_time = 0.0;
+        double first_model_time = 0.0;  // From the start of the search, or 0 if no level was found
+        double best_model_time = 0.0;  // From the start of the search, or 0 if no level was found
+        double decode_time = 0.0;  // Spent turning models into levels, included in solve_time
+
+        uint64_t num_atoms = 0;  // In the ground program
+        uint64_t num_rules = 0;  // In the ground program
+        uint64_t num_choices = 0;
+        uint64_t num_conflicts = 0;
+        uint64_t num_restarts = 0;
+        uint64_t num_models = 0;
+
+        bool optimality_proven = false;  // Whether the best level is known to be optimal for the inputs
+        bool pregrounded = false;  // Whether the ground program was built in for this size, skipping parse and ground
+};
+
+/// The result of a solve with a time budget
+struct LEVEL_GEN_API TimedSolveResult {
+        Level* level;  // The best level found within the budget, or nullptr if none was
+        bool optimality_proven;  // Whether the level is known to be optimal for the inputs
+        bool timed_out;  // Whether the budget ran out before the search finished
+};
+
+class LevelGenerator;
+
+/// A solve running in the background, started by LevelGenerator::solve_async(). Rather than blocking a thread on
+/// solve(), the caller checks on the search from its own loop, e.g. once per frame, and uses the best level so far.
+/// The handle is owned by its generator, and is reused by each call to solve_async().
+class LEVEL_GEN_API AsyncSolve {
+    public:
+        virtual ~AsyncSolve();
+
+        CS_IGNORE AsyncSolve(const AsyncSolve& other) = delete;
+        CS_IGNORE AsyncSolve& operator=(const AsyncSolve& other) = delete;
+
+        /// Check whether the search has finished, without blocking
+        bool poll();
+
+        /// Wait up to timeout_ms for the search to finish, returning whether it has
+        bool wait(unsigned timeout_ms);
+
+        /// Stop the search, blocking until the solver has stopped. The levels found so far are kept.
+        void cancel();
+
+        /// Get the number of levels found so far, including any not kept by LevelGenerator::set_max_kept_levels()
+        size_t models_so_far() const;
+
+        /// Get the best level found so far, or nullptr if there is none yet. Levels are not moved while the search
+        /// continues, so this is valid for as long as LevelGenerator::best_level() would be.
+        Level* best();
+
+    private:
+        CS_IGNORE class AsyncSolveImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<AsyncSolveImpl> impl;
+
+        CS_IGNORE explicit AsyncSolve(std::unique_ptr<AsyncSolveImpl> impl);
+
+        friend class LevelGenerator;
+};
+
 class LEVEL_GEN_API LevelGenerator {
     public:
 
@@ -205,7 +392,27 @@ class LEVEL_GEN_API LevelGenerator {
                unsigned num_portals,
                size_t seed = 0,  // Indicates "unset"
                bool load_prog_from_file = false,  // Load ASP program from file at runtime, for easier iteration during dev
-               unsigned num_threads = 1
+               unsigned num_threads = 1,
+               ParallelMode parallel_mode = ParallelMode::Split,
+               const char* portfolio_path = nullptr,  // clasp configuration file for compete mode, or clasp's default
+               const char* config_path = nullptr  // Solver config file, e.g. from level-gen-tune, or the built-in one
+        );
+
+        /// As above, but overriding individual clingo configuration keys, e.g. {{"solver.restarts", "L,100"}}.
+        /// These are applied over the built-in tuned config, and over the generator's own settings, such as the number
+        /// of levels.
+        CS_IGNORE LevelGenerator(
+               unsigned max_num_levels,
+               unsigned width,
+               unsigned height,
+               unsigned min_rooms,
+               unsigned max_rooms,
+               unsigned num_breaches,
+               unsigned num_portals,
+               const ConfigMap& config_overrides,
+               size_t seed = 0,
+               unsigned num_threads = 1,
+               ParallelMode parallel_mode = ParallelMode::Split
         );
 
         virtual ~LevelGenerator();
@@ -215,22 +422,275 @@ class LEVEL_GEN_API LevelGenerator {
         CS_IGNORE LevelGenerator(const LevelGenerator& other) = delete;
         CS_IGNORE LevelGenerator& operator=(const LevelGenerator& other) = delete;
 
+        /// Change the inputs used by subsequent calls to solve(), apart from the grid size.
+        /// The program is only grounded once per generator, on the first solve(), so solving again with new inputs only
+        /// pays for the search.
+        void set_inputs(unsigned min_rooms, unsigned max_rooms, unsigned num_breaches, unsigned num_portals,
+                        size_t seed = 0);
+
+        /// Change when subsequent calls to solve() stop searching. max_cost is the threshold for OptMode::CostBound, and
+        /// is ignored by the other modes. Note this replaces any "solve.models" or "solve.opt_mode" config override.
+        void set_opt_mode(OptMode mode, int max_cost = std::numeric_limits<int>::max());
+
+        /// Keep only the best max_levels levels from each solve, rather than every level found, or pass 0 to keep every
+        /// level, which is the default. Levels that would not be kept are never decoded, so are not passed to the level
+        /// callback either. Lowering the limit drops the worst levels straight away.
+        void set_max_kept_levels(size_t max_levels);
+
+        /// Register a callback, fired from solve() as soon as each level is decoded. Each level found improves on the
+        /// previous ones, so the first acceptable level can be used while the solver keeps improving on it.
+        /// Note the level reference is only valid during the callback. Pass nullptr to remove the callback.
+        void set_level_callback(level_cb on_level);
+
+        /// Enable dumping every model found as text, as clingo shows it, returned from solve(). This is off by default,
+        /// as it adds formatting to every model, so use Level::get_level_text() to get the text for a single level
+        /// instead.
+        void set_dump_models(bool dump);
+
+        /// Solve for levels using the current inputs. This can be called more than once, each call replacing the
+        /// levels from the previous one.
+        /// Returns the text of every model found if set_dump_models() is enabled, or an empty string otherwise.
         const char* solve(cancel_cb check_cancel = nullptr);
 
+        /// As solve(), but with a cancel check that can hold state. This is checked after each level is found, so can
+        /// also be used to stop once a good enough level has been found.
+        CS_IGNORE const char* solve(const std::function<bool(void)>& check_cancel);
+
+        /// As solve(), but cancelled through a token, which can be cancelled from any thread. The token must outlive
+        /// the call.
+        const char* solve(CancelToken& token);
+
+        /// As solve(CancelToken&), but also stopping once check_cancel returns true, which is checked after each level
+        /// is found
+        CS_IGNORE const char* solve(CancelToken& token, const std::function<bool(void)>& check_cancel);
+
         const char* solve_safe(cancel_cb check_cancel = nullptr);
 
+        /// Solve for levels using the current inputs, stopping the search once the budget runs out, even if no level
+        /// has been found. This returns the best level found, which is valid until the generator is solved again or
+        /// destroyed. Note grounding, on the first solve, counts towards the budget, but cannot be cut short.
+        CS_IGNORE TimedSolveResult solve_for(std::chrono::milliseconds budget);
+
+        TimedSolveResult solve_for(unsigned budget_ms);
+
+        /// Start solving for levels in the background, returning straight away. Any solve still running is cancelled
+        /// first. The level callback, if set, is fired from the solver's thread. Note grounding, on the first solve, is
+        /// still done before this returns.
+        /// Note the returned handle is owned by the generator, and is only valid until it is destroyed.
+        AsyncSolve* solve_async();
+
         void interrupt();
 
         bool interrupt_if_has_level();
 
-        /// Get a pointer to the best level - note this pointer is only valid for the lifetime of the generator
+        /// Get a pointer to the best level, which is kept up to date as levels are found, so this is cheap to call while
+        /// solving. Note this pointer is only valid until the generator is solved again or destroyed, even if a limit on
+        /// the levels kept drops it in the meantime.
         Level* best_level();
 
+        /// Get the number of levels kept from the current or last solve
         size_t get_num_levels() const;
 
+        /// Get the name of the solver config used, i.e. "default" for the built-in tuned config, or "file" if the
+        /// config was loaded from a file
+        const char* get_config_profile() const;
+
+        /// Get statistics from the last solve, e.g. to tell whether a slow solve was spent grounding or searching
+        GenStats get_stats() const;
+
     private:
         CS_IGNORE class LevelGenImpl;  // Internal implementation class
         CS_IGNORE std::unique_ptr<LevelGenImpl> impl;
+
+        friend class AsyncSolve;
+        friend std::unique_ptr<Level> LEVEL_GEN_API take_best_level(LevelGenerator& gen);
+};
+
+/// Take the generator's best level out of it, e.g. to keep it after the generator is solved again, or nullptr if there
+/// is none. The level is no longer kept by the generator, and the best of the levels left takes its place.
+CS_IGNORE LEVEL_GEN_API std::unique_ptr<Level> take_best_level(LevelGenerator& gen);
+
+/// A bounded pool of already-solved levels for a single set of generator params. Background workers keep the pool
+/// topped up, so that a level is ready as soon as it is needed, rather than waiting for the whole solve.
+class LEVEL_GEN_API LevelPool {
+    public:
+
+        LevelPool(
+                unsigned capacity,
+                unsigned width,
+                unsigned height,
+                unsigned min_rooms,
+                unsigned max_rooms,
+                unsigned num_breaches,
+                unsigned num_portals,
+                unsigned num_workers = 1,
+                unsigned max_num_levels = 1,  // Per solve, the best of which is added to the pool
+                unsigned num_threads = 1  // Per worker
+        );
+
+        virtual ~LevelPool();
+
+        CS_IGNORE LevelPool(LevelPool&& other) noexcept;
+        CS_IGNORE LevelPool& operator=(LevelPool && other) noexcept;
+        CS_IGNORE LevelPool(const LevelPool& other) = delete;
+        CS_IGNORE LevelPool& operator=(const LevelPool& other) = delete;
+
+        /// Take a ready level if there is one, without blocking, otherwise return nullptr. Once no level is ready,
+        /// rethrows the first error from any worker, e.g. failing to ground.
+        /// Note the returned pointer is only valid until the next take, or the pool is destroyed.
+        Level* try_take();
+
+        /// Take a ready level, waiting up to timeout_ms for one to be generated, otherwise return nullptr. Once no
+        /// level is ready, rethrows the first error from any worker, e.g. failing to ground.
+        /// Note the returned pointer is only valid until the next take, or the pool is destroyed.
+        Level* take(unsigned timeout_ms);
+
+        size_t get_num_ready() const;
+
+        /// Stop the workers refilling the pool - ready levels can still be taken
+        void stop();
+
+    private:
+        CS_IGNORE class LevelPoolImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<LevelPoolImpl> impl;
+};
+
+/// Quality metrics for a level, matching those in level-gen-python/evaluation/metrics. Each score is normalised to
+/// roughly between 0 and 1. Alien breaches are not counted as rooms, but the rooms they breach are sources of danger.
+/// Scoring is cheap enough to run on every level as it is found, e.g. from a level callback, to choose between levels
+/// by quality rather than only by cost.
+struct LEVEL_GEN_API LevelMetrics {
+        double density;  // Room area over the area inside the hull
+        double exploration;  // Average distance of rooms off the shortest start->finish path from that path
+        double map_linearity;  // Average of 1 / (exits - 1) over rooms with more than one exit, 1 for a corridor
+        double path_redundancy;  // Proportion of rooms not on the shortest start->finish path
+        double proximity_to_danger;  // Average distance from the shortest start->finish path to breached rooms
+        double average_room_size;  // Average room area over the max room area
+        double room_count;  // Number of rooms over the area inside the hull
+
+        explicit LevelMetrics(const Level& level, unsigned max_room_size = 4 * 4);
+};
+
+/// Params for one level generated by generate_batch()
+struct LEVEL_GEN_API GenParams {
+        unsigned width;
+        unsigned height;
+        unsigned min_rooms;
+        unsigned max_rooms;
+        unsigned num_breaches;
+        unsigned num_portals;
+        size_t seed;  // 0 indicates "unset"
+        unsigned max_num_levels;  // The best of which is returned
+
+        GenParams(unsigned width, unsigned height, unsigned min_rooms, unsigned max_rooms, unsigned num_breaches,
+                  unsigned num_portals, size_t seed = 0, unsigned max_num_levels = 1)
+            : width(width), height(height), min_rooms(min_rooms), max_rooms(max_rooms), num_breaches(num_breaches),
+              num_portals(num_portals), seed(seed), max_num_levels(max_num_levels) {}
+};
+
+/// Generate a level for each set of params, spreading the work over a pool of worker threads, e.g. to build a level
+/// pack offline. Workers steal queued jobs from each other once their own queue is empty, and reuse their generators
+/// for jobs with the same grid size, so each worker only grounds the program once per size.
+/// Returns the best level for each set of params, in the same order, or nullptr where no level was found. If any job
+/// fails, e.g. to ground, the rest of the batch is abandoned and the first error is rethrown.
+CS_IGNORE LEVEL_GEN_API std::vector<std::unique_ptr<Level>> generate_batch(
+        const std::vector<GenParams>& params,
+        unsigned num_workers,
+        unsigned num_threads = 1  // Per worker
+);
+
+/// Races independent generators with different seeds against each other, returning the first level to meet a cost
+/// threshold. The time to solve for a set of params can vary wildly between seeds, so racing several cuts down on the
+/// worst cases, whereas the threads of a single generator all share its seed.
+class LEVEL_GEN_API RacingLevelGenerator {
+    public:
+
+        RacingLevelGenerator(
+                unsigned num_racers,
+                unsigned max_num_levels,  // Per racer
+                unsigned width,
+                unsigned height,
+                unsigned min_rooms,
+                unsigned max_rooms,
+                unsigned num_breaches,
+                unsigned num_portals,
+                size_t seed = 0,  // Racers use consecutive seeds from this, or random ones if it is 0
+                unsigned num_threads = 1  // Per racer
+        );
+
+        virtual ~RacingLevelGenerator();
+
+        CS_IGNORE RacingLevelGenerator(RacingLevelGenerator&& other) noexcept;
+        CS_IGNORE RacingLevelGenerator& operator=(RacingLevelGenerator && other) noexcept;
+        CS_IGNORE RacingLevelGenerator(const RacingLevelGenerator& other) = delete;
+        CS_IGNORE RacingLevelGenerator& operator=(const RacingLevelGenerator& other) = delete;
+
+        /// Race the generators until one finds a level with a cost of at most max_cost, then interrupt the rest.
+        /// If no racer meets the threshold, the best level found by any of them is returned, or nullptr if none were.
+        /// If no racer wins and any of them failed, e.g. to ground, the first error is rethrown once the rest stop.
+        /// Note check_cancel is called from every racer's thread, and the returned pointer is only valid until the
+        /// next solve, or the generator is destroyed.
+        Level* solve(int max_cost = std::numeric_limits<int>::max(), cancel_cb check_cancel = nullptr);
+
+        /// Interrupt all racers, from another thread. An interrupt just before solve() is called also stops it.
+        void interrupt();
+
+        /// The index of the racer that produced the last level returned by solve(), or -1 if there was none
+        int get_winner() const;
+
+        unsigned get_num_racers() const;
+
+    private:
+        CS_IGNORE class RacingImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<RacingImpl> impl;
+};
+
+/// Generates large levels in sections, as the time to ground and solve a whole ship grows much faster than its area.
+/// The grid is split into sections of roughly section_size squares across, each with its share of the rooms, which are
+/// solved independently in parallel. Neighbouring sections are joined by a pair of corridors either side of their
+/// boundary, then a final, much smaller solve stitches the rooms together into one level, choosing the connections,
+/// portals, breaches and start and finish rooms for the whole ship, as for a level from LevelGenerator.
+/// Rooms never straddle a boundary, and a section can have no solution where the whole ship would have one, so this is
+/// best for sizes that are too slow to solve whole, e.g. 48x48 and above.
+class LEVEL_GEN_API SectionedLevelGenerator {
+    public:
+
+        SectionedLevelGenerator(
+                unsigned max_num_levels,  // For each section and the stitch, or 0 to solve each to the optimum
+                unsigned width,
+                unsigned height,
+                unsigned min_rooms,
+                unsigned max_rooms,
+                unsigned num_breaches,
+                unsigned num_portals,
+                size_t seed = 0,  // Sections use consecutive seeds from this, or random ones if it is 0
+                unsigned section_size = 16,
+                unsigned num_workers = 0  // Sections solved at once, or 0 for one per hardware thread
+        );
+
+        virtual ~SectionedLevelGenerator();
+
+        CS_IGNORE SectionedLevelGenerator(SectionedLevelGenerator&& other) noexcept;
+        CS_IGNORE SectionedLevelGenerator& operator=(SectionedLevelGenerator && other) noexcept;
+        CS_IGNORE SectionedLevelGenerator(const SectionedLevelGenerator& other) = delete;
+        CS_IGNORE SectionedLevelGenerator& operator=(const SectionedLevelGenerator& other) = delete;
+
+        /// Solve every section, then stitch them together, returning the level, or nullptr if a section or the stitch
+        /// has no solution. If cancelled while stitching, the best level found so far is returned, if any. Throws the
+        /// first error from solving any section or the stitch.
+        /// Note check_cancel is called from every worker's thread, and the returned pointer is only valid until the
+        /// next solve, or the generator is destroyed.
+        Level* solve(cancel_cb check_cancel = nullptr);
+
+        /// Interrupt the solve, from another thread. An interrupt just before solve() is called also stops it.
+        void interrupt();
+
+        /// The number of sections with part of the ship in them, i.e. those solved
+        unsigned get_num_sections() const;
+
+    private:
+        CS_IGNORE class SectionedImpl;  // Internal implementation class
+        CS_IGNORE std::unique_ptr<SectionedImpl> impl;
 };
 
 #endif // LEVEL_GEN_H
@@ -1,43 +1,107 @@
 #include "level_gen.h"
+#include "byte_io.h"
 #include "clingo.hh"
 
+#include <array>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
 #include <memory>
-#include <unordered_map>
+#include <mutex>
 #include <sstream>
-#include <tl/optional.hpp>
+#include <stdexcept>
 
 namespace
 {
-    inline std::vector<unsigned> unsigned_args(const Clingo::Symbol& sym)
+    /// The kinds of model symbol that make up a level
+    enum class LevelSymbol : uint8_t
     {
-        std::vector<unsigned> ret;
-        if (sym.type() == Clingo::SymbolType::Function)
+        Other,
+        Ship,
+        Hull,
+        InSpace,
+        RoomSquare,
+        Corridor,
+        BreachSquare,
+        Room,
+        AlienBreach,
+        Connected,
+        Portal,
+        StartRoom,
+        FinishRoom,
+    };
+
+    struct SymbolSignature
+    {
+        const char* name;
+        size_t arity;
+        LevelSymbol kind;
+    };
+
+    /// Signatures of the symbols making up a level, roughly in order of frequency in a model, so the common square
+    /// symbols are resolved first
+    const SymbolSignature level_signatures[] = {
+        {"ship", 2, LevelSymbol::Ship},
+        {"hull", 2, LevelSymbol::Hull},
+        {"in_space", 2, LevelSymbol::InSpace},
+        {"room_square", 6, LevelSymbol::RoomSquare},
+        {"corridor", 2, LevelSymbol::Corridor},
+        {"breach_square", 6, LevelSymbol::BreachSquare},
+        {"room", 4, LevelSymbol::Room},
+        {"alien_breach", 6, LevelSymbol::AlienBreach},
+        {"connected", 4, LevelSymbol::Connected},
+        {"portal", 4, LevelSymbol::Portal},
+        {"start_room", 2, LevelSymbol::StartRoom},
+        {"finish_room", 2, LevelSymbol::FinishRoom},
+    };
+
+    constexpr size_t max_level_symbol_arity = 6;
+
+    using SymbolArgs = std::array<unsigned, max_level_symbol_arity>;
+
+    constexpr size_t num_level_signatures = sizeof(level_signatures) / sizeof(level_signatures[0]);
+
+    /// clingo interns symbol names, so every symbol with the same name shares one copy of it. Looking up each
+    /// signature's copy once means symbol names can then be compared by pointer, rather than by string.
+    const std::array<const char*, num_level_signatures>& interned_signature_names()
+    {
+        static const auto names = []() {
+            std::array<const char*, num_level_signatures> interned{};
+            for (size_t i = 0; i < num_level_signatures; ++i)
+            {
+                interned[i] = Clingo::Function(level_signatures[i].name, {}).name();
+            }
+            return interned;
+        }();
+        return names;
+    }
+
+    inline LevelSymbol resolve_symbol(const char* name, size_t arity,
+                                      const std::array<const char*, num_level_signatures>& interned_names)
+    {
+        for (size_t i = 0; i < num_level_signatures; ++i)
         {
-            for (const auto& arg : sym.arguments())
+            if (interned_names[i] == name && level_signatures[i].arity == arity)
             {
-                if (arg.type() != Clingo::SymbolType::Number)
-                {
-                    return {};
-                }
-                ret.push_back(static_cast<unsigned>(arg.number()));
+                return level_signatures[i].kind;
             }
         }
-        return ret;
+        return LevelSymbol::Other;
     }
 
-    inline size_t find_room(const std::vector<Room>& rooms, unsigned room_x, unsigned room_y)
+    /// Read all arguments as unsigned numbers, without allocating, returning false if any are not numbers
+    inline bool unsigned_args(const Clingo::SymbolSpan& sym_args, SymbolArgs& args)
     {
-        const auto room = std::find_if(
-            rooms.cbegin(),
-            rooms.cend(),
-            [=](const auto& room) { return room.x == room_x && room.y == room_y; }
-        );
-
-        if (room == rooms.cend())
+        auto i = 0U;
+        for (const auto& arg : sym_args)
         {
-            return 0;
+            if (arg.type() != Clingo::SymbolType::Number)
+            {
+                return false;
+            }
+            args[i++] = static_cast<unsigned>(arg.number());
         }
-        return room->room_id;
+        return true;
     }
 
     /// Converts a one-indexed (x, y) coordinate to a zero-indexed serial grid index, in row-major style
@@ -46,121 +110,91 @@ namespace
         return (y - 1) * (uint64_t)width + (x - 1);
     }
 
-    /// Converts zero-indexed serial grid index, in row-major style, to a one-indexed (x, y) coordinate
-    inline std::tuple<unsigned, unsigned> serial_index_to_square_pos(uint64_t index, unsigned width)
+    /// A dense, row-major grid of values, indexed by one-indexed (x, y) coordinates
+    template <class T>
+    class DenseGrid
     {
-        return {static_cast<unsigned>(index % width) + 1, static_cast<unsigned>(index / width) + 1};
-    }
+        public:
+            DenseGrid(unsigned width, unsigned height)
+                : width(width), height(height), cells(static_cast<size_t>(width) * height, T{}) {}
 
-    inline tl::optional<Room> try_get_room(const Clingo::Symbol &sym, size_t next_id)
-    {
-        if (!sym.match("room", 4))
-        {
-            return tl::nullopt;
-        }
+            /// Get a cell, or nullptr if the coordinate is outside the grid
+            T* at(unsigned x, unsigned y)
+            {
+                if (x < 1 || y < 1 || x > width || y > height)
+                {
+                    return nullptr;
+                }
+                return &cells[square_pos_to_serial_index(x, y, width)];
+            }
 
-        const auto args = unsigned_args(sym);
-        const auto x = args[0];
-        const auto y = args[1];
-        const auto rw = args[2];
-        const auto rh = args[3];
-        const auto is_corridor = rh == 1U;
+            const std::vector<T>& values() const
+            {
+                return cells;
+            }
 
-        return tl::make_optional<Room>(x, y, rw, rh, is_corridor ? RoomType::Corridor : RoomType::Room, next_id);
-    }
+            /// Move the cells out of the grid, leaving it empty
+            std::vector<T> release()
+            {
+                return std::move(cells);
+            }
 
-    inline tl::optional<MapSquare> try_get_square(const Clingo::Symbol &sym)
-    {
-        SquareType type;
-        if (sym.match("in_space", 2))
-        {
-            type = SquareType::Space;
-        }
-        else if (sym.match("hull", 2))
-        {
-            type = SquareType::Hull;
-        }
-        else if (sym.match("ship", 2))
-        {
-            type = SquareType::Ship;
-        }
-        else if (sym.match("corridor", 2))
-        {
-            type = SquareType::Corridor;
-        }
-        else if (sym.match("room_square", 6))
-        {
-            type = SquareType::Room;
-        }
-        else if (sym.match("breach_square", 6))
-        {
-            type = SquareType::AlienBreach;
-        }
-        else
-        {
-            return tl::nullopt;  // Not a map square symbol
-        }
+        private:
+            const unsigned width;
+            const unsigned height;
+            std::vector<T> cells;
+    };
 
-        const auto args = unsigned_args(sym);
-        const auto sqx = args[0];
-        const auto sqy = args[1];
+    /// Serialized level format identifier and version - bump the version whenever the format changes
+    const char level_magic[] = "WSLV";
+    constexpr uint16_t level_format_version = 1;
 
-        return tl::make_optional<MapSquare>(sqx, sqy, type);
-    }
+    /// Limit of the 16-bit fields used for sizes, positions and IDs, both in memory and in the serialized format
+    constexpr size_t max_packed_value = std::numeric_limits<uint16_t>::max();
 
-    template <class T>
-    inline tl::optional<T> try_get_connection(const char *symbol_name, const Clingo::Symbol &sym, const std::vector<Room>& room_vec)
+    inline uint16_t checked_packed_value(size_t value)
     {
-        if (!sym.match(symbol_name, 4))
+        if (value > max_packed_value)
         {
-            return tl::nullopt;
+            throw std::runtime_error("level is too large: " + std::to_string(value) + " does not fit in 16 bits");
         }
-
-        const auto args = unsigned_args(sym);
-
-        const auto first = find_room(room_vec, args[0], args[1]);
-        const auto second = find_room(room_vec, args[2], args[3]);
-        if (first == 0 || second == 0)
-        {
-            return tl::nullopt;
-        }
-
-        return tl::make_optional<T>(first, second);
+        return static_cast<uint16_t>(value);
     }
 
-    inline tl::optional<Door> try_get_door(const Clingo::Symbol &sym, const std::vector<Room>& room_vec)
+    /// A room as stored in a level, with its ID implied by its position in the level's rooms
+    struct PackedRoom
     {
-        return try_get_connection<Door>("connected", sym, room_vec);
-    }
-
-    inline tl::optional<Portal> try_get_portal(const Clingo::Symbol &sym, const std::vector<Room>& room_vec)
+        uint16_t x;
+        uint16_t y;
+        uint16_t w;
+        uint16_t h;
+        RoomType type;
+    };
+
+    /// A door or portal as stored in a level - connections go both ways, so each is only stored one way
+    struct PackedConnection
     {
-        return try_get_connection<Portal>("portal", sym, room_vec);
-    }
+        uint16_t first_id;
+        uint16_t second_id;
+    };
 
-    inline tl::optional<std::tuple<Room, size_t>> try_get_breach(const Clingo::Symbol &sym, const std::vector<Room>& room_vec, size_t next_id)
+    /// The decoded parts of a level, before they are packed
+    struct LevelParts
     {
-        if (!sym.match("alien_breach", 6))
-        {
-            return tl::nullopt;
-        }
-
-        const auto args = unsigned_args(sym);
-
-        // Convert the breach to a room with a special room type, connected to the breached room
-        auto breached_room = find_room(room_vec, args[4], args[5]);
-        if (breached_room == 0)
-        {
-            return tl::nullopt;
-        }
-
-        return tl::make_optional<std::tuple<Room, size_t>>(
-            std::make_tuple<Room, size_t>(
-                Room{args[0], args[1], args[2], args[3], RoomType::AlienBreach, next_id},
-                std::move(breached_room)
-            )
-        );
-    }
+        std::vector<uint8_t> square_grid;
+        std::vector<PackedRoom> rooms;
+        std::vector<PackedConnection> doors;
+        std::vector<PackedConnection> portals;
+        size_t start_room_id = 0;
+        size_t finish_room_id = 0;
+    };
+
+    /// A symbol that refers to rooms by position, so is resolved after all rooms have been read
+    struct RoomReference
+    {
+        LevelSymbol kind;
+        SymbolArgs args;
+    };
 } // unnamed namespace
 
 bool operator==(const Room& first, const Room& second)
@@ -189,121 +223,294 @@ bool operator==(const Portal& first, const Portal& second)
 class Level::LevelImpl
 {
     public:
-        LevelImpl(unsigned width, unsigned height, int64_t cost, const std::vector<uint64_t>& data) 
-        : cost(static_cast<int>(cost)), width(width), height(height), num_corridors(0), num_breaches(0)
+        LevelImpl(unsigned width, unsigned height, int64_t cost, const std::vector<uint64_t>& data)
+        : LevelImpl(width, height, static_cast<int>(cost), decode(width, height, data))
+        {}
+
+        /// Create a level from already-decoded parts, e.g. when deserializing
+        LevelImpl(unsigned width, unsigned height, int cost, LevelParts parts)
+        : cost(cost), width(checked_packed_value(width)), height(checked_packed_value(height)),
+        num_rooms(checked_packed_value(parts.rooms.size())), num_doors(checked_packed_value(parts.doors.size())),
+        num_portals(checked_packed_value(parts.portals.size())),
+        start_room_id(checked_packed_value(parts.start_room_id)),
+        finish_room_id(checked_packed_value(parts.finish_room_id))
         {
-            std::unordered_map<uint64_t, SquareType> square_lookup;
+            // Pack the grid, then rooms, doors and portals, into a single allocation
+            packed.reserve(parts.square_grid.size() + parts.rooms.size() * sizeof(PackedRoom)
+                           + (parts.doors.size() + parts.portals.size()) * sizeof(PackedConnection));
+            packed.insert(packed.end(), parts.square_grid.cbegin(), parts.square_grid.cend());
+            append_packed(parts.rooms);
+            append_packed(parts.doors);
+            append_packed(parts.portals);
+
+            for (const auto type : parts.square_grid)
+            {
+                num_map_squares += type != 0 ? 1 : 0;
+            }
+            for (const auto& room : parts.rooms)
+            {
+                num_corridors += room.type == RoomType::Corridor ? 1 : 0;
+                num_breaches += room.type == RoomType::AlienBreach ? 1 : 0;
+            }
+        }
 
-            // Map symbols to simple data structures to return from the API
-            // First pass gets map objects - rooms, corridors, and other grid squares
-            for (const auto& sym_val : data)
+    private:
+        /// Decode the parts of a level from a model's symbols
+        static LevelParts decode(unsigned width, unsigned height, const std::vector<uint64_t>& symbols)
+        {
+            LevelParts parts;
+
+            // Square types are written straight into the grid, keeping the highest precedence type for each square
+            DenseGrid<uint8_t> square_grid(width, height);
+            // Room IDs, indexed by each room's top-left square, with zero meaning no room
+            DenseGrid<size_t> room_grid(width, height);
+            std::vector<RoomReference> room_refs;
+
+            // Single pass over the symbols, reading rooms and squares directly, and deferring anything that refers to
+            // rooms until all rooms are known
+            SymbolArgs args{};
+            const auto& interned_names = interned_signature_names();
+            for (const auto& sym_val : symbols)
             {
                 const Clingo::Symbol sym{sym_val};
-                if (sym.type() != Clingo::SymbolType::Function || sym.arguments().size() < 2)
+                if (sym.type() != Clingo::SymbolType::Function)
                 {
                     continue;
                 }
 
-                if (auto room = try_get_room(sym, room_vec.size() + 1))
+                const auto sym_args = sym.arguments();
+                if (sym_args.size() < 2 || sym_args.size() > max_level_symbol_arity)
                 {
-                    if (room->type == RoomType::Corridor)
-                    {
-                        ++num_corridors;
-                    }
+                    continue;
+                }
 
-                    room_vec.emplace_back(room.value());
+                const auto kind = resolve_symbol(sym.name(), sym_args.size(), interned_names);
+                if (kind == LevelSymbol::Other || !unsigned_args(sym_args, args))
+                {
                     continue;
                 }
 
-                if (auto sq = try_get_square(sym))
+                switch (kind)
                 {
-                    const auto key = square_pos_to_serial_index(sq->x, sq->y, width);
-                    const auto pair = square_lookup.emplace(key, sq->type);
-                    // If key already existed, insert if new type has higher precedence
-                    if (!pair.second && (uint8_t) pair.first->second < (uint8_t) sq->type)
+                    case LevelSymbol::Ship:
+                        add_square(square_grid, args, SquareType::Ship);
+                        break;
+                    case LevelSymbol::Hull:
+                        add_square(square_grid, args, SquareType::Hull);
+                        break;
+                    case LevelSymbol::InSpace:
+                        add_square(square_grid, args, SquareType::Space);
+                        break;
+                    case LevelSymbol::RoomSquare:
+                        add_square(square_grid, args, SquareType::Room);
+                        break;
+                    case LevelSymbol::Corridor:
+                        add_square(square_grid, args, SquareType::Corridor);
+                        break;
+                    case LevelSymbol::BreachSquare:
+                        add_square(square_grid, args, SquareType::AlienBreach);
+                        break;
+                    case LevelSymbol::Room:
                     {
-                        square_lookup[key] = sq->type;
+                        const auto is_corridor = args[3] == 1U;
+                        add_room(parts.rooms, args, is_corridor ? RoomType::Corridor : RoomType::Room);
+                        if (auto* room_id = room_grid.at(args[0], args[1]))
+                        {
+                            *room_id = parts.rooms.size();
+                        }
+                        break;
                     }
+                    default:
+                        room_refs.push_back({kind, args});
+                        break;
                 }
             }
 
-            // Second pass gets connections, breaches, and start/finish points, referring to already-created rooms
-            for (const auto& sym_val : data)
+            // Resolve connections, breaches, and start/finish points, in the order they were found
+            const auto find_room = [&](unsigned x, unsigned y) -> size_t {
+                const auto* room_id = room_grid.at(x, y);
+                return room_id ? *room_id : 0;
+            };
+            for (const auto& ref : room_refs)
             {
-                const Clingo::Symbol sym{sym_val};
-
-                if (auto portal = try_get_portal(sym, room_vec))
+                const auto& ref_args = ref.args;
+                switch (ref.kind)
                 {
-                    // Connect both ways
-                    portal_vec.emplace_back(portal.value());
-                    portal_vec.emplace_back(portal->second_id, portal->first_id);
-                    continue;
+                    case LevelSymbol::Connected:
+                    case LevelSymbol::Portal:
+                    {
+                        const auto first = find_room(ref_args[0], ref_args[1]);
+                        const auto second = find_room(ref_args[2], ref_args[3]);
+                        if (first == 0 || second == 0)
+                        {
+                            break;
+                        }
+
+                        auto& connections = ref.kind == LevelSymbol::Portal ? parts.portals : parts.doors;
+                        connections.push_back(pack_connection(first, second));
+                        break;
+                    }
+                    case LevelSymbol::AlienBreach:
+                    {
+                        // Convert the breach to a room with a special room type, connected to the breached room
+                        const auto breached_room = find_room(ref_args[4], ref_args[5]);
+                        if (breached_room == 0)
+                        {
+                            break;
+                        }
+
+                        // Add a breach room, and a "door" to the connected room
+                        add_room(parts.rooms, ref_args, RoomType::AlienBreach);
+                        parts.doors.push_back(pack_connection(breached_room, parts.rooms.size()));
+                        break;
+                    }
+                    case LevelSymbol::StartRoom:
+                        parts.start_room_id = find_room(ref_args[0], ref_args[1]);
+                        break;
+                    case LevelSymbol::FinishRoom:
+                        parts.finish_room_id = find_room(ref_args[0], ref_args[1]);
+                        break;
+                    default:
+                        break;
                 }
+            }
 
-                if (auto door = try_get_door(sym, room_vec))
-                {
-                    // Connect both ways
-                    door_vec.emplace_back(door.value());
-                    door_vec.emplace_back(door->second_id, door->first_id);
-                    continue;
-                }
+            parts.square_grid = square_grid.release();
+            return parts;
+        }
 
-                if (auto breach = try_get_breach(sym, room_vec, room_vec.size() + 1))
-                {
-                    // Add a breach room, and a two-way "door" to the connected room
-                    room_vec.emplace_back(std::get<0>(breach.value()));
-                    door_vec.emplace_back(std::get<1>(breach.value()), room_vec.back().room_id);
-                    door_vec.emplace_back(room_vec.back().room_id, std::get<1>(breach.value()));
-                    ++num_breaches;
-                    continue;
-                }
+        static void add_square(DenseGrid<uint8_t>& square_grid, const SymbolArgs& args, SquareType type)
+        {
+            // Where a square has more than one type, the higher-numbered type takes priority
+            auto* square = square_grid.at(args[0], args[1]);
+            if (square && *square < static_cast<uint8_t>(type))
+            {
+                *square = static_cast<uint8_t>(type);
+            }
+        }
 
-                const auto args = unsigned_args(sym);
+        static void add_room(std::vector<PackedRoom>& rooms, const SymbolArgs& args, RoomType type)
+        {
+            rooms.push_back({checked_packed_value(args[0]), checked_packed_value(args[1]),
+                             checked_packed_value(args[2]), checked_packed_value(args[3]), type});
+        }
 
-                if (sym.match("start_room", 2))
-                {
-                    start_room_id = find_room(room_vec, args[0], args[1]);
-                    continue;
-                }
+        static PackedConnection pack_connection(size_t first_id, size_t second_id)
+        {
+            return {checked_packed_value(first_id), checked_packed_value(second_id)};
+        }
 
-                if (sym.match("finish_room", 2))
+        template <class T>
+        void append_packed(const std::vector<T>& parts)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(parts.data());
+            packed.insert(packed.end(), bytes, bytes + parts.size() * sizeof(T));
+        }
+
+        /// Read a packed part, copying it out, as parts are not aligned within the packed data
+        template <class T>
+        T packed_at(size_t offset, size_t index) const
+        {
+            T part;
+            std::memcpy(&part, packed.data() + offset + index * sizeof(T), sizeof(T));
+            return part;
+        }
+
+        size_t rooms_offset() const
+        {
+            return static_cast<size_t>(width) * height;
+        }
+
+        size_t doors_offset() const
+        {
+            return rooms_offset() + num_rooms * sizeof(PackedRoom);
+        }
+
+        size_t portals_offset() const
+        {
+            return doors_offset() + num_doors * sizeof(PackedConnection);
+        }
+
+        PackedRoom room_at(size_t index) const
+        {
+            return packed_at<PackedRoom>(rooms_offset(), index);
+        }
+
+        PackedConnection door_at(size_t index) const
+        {
+            return packed_at<PackedConnection>(doors_offset(), index);
+        }
+
+        PackedConnection portal_at(size_t index) const
+        {
+            return packed_at<PackedConnection>(portals_offset(), index);
+        }
+
+        /// Expand connections stored one way into both ways, as listed by the part iterators
+        template <class T>
+        std::shared_ptr<std::vector<T>> expand_connections(size_t offset, size_t num) const
+        {
+            auto parts = std::make_shared<std::vector<T>>();
+            parts->reserve(num * 2);
+            for (size_t i = 0; i < num; ++i)
+            {
+                const auto connection = packed_at<PackedConnection>(offset, i);
+                parts->emplace_back(connection.first_id, connection.second_id);
+                parts->emplace_back(connection.second_id, connection.first_id);
+            }
+            return parts;
+        }
+
+        // The part iterators own the parts they expand, so nothing is expanded for the lifetime of the level
+
+        LevelPartIter<MapSquare> map_squares() const
+        {
+            auto parts = std::make_shared<std::vector<MapSquare>>();
+            parts->reserve(num_map_squares);
+            for (auto y = 1U; y <= height; ++y)
+            {
+                for (auto x = 1U; x <= width; ++x)
                 {
-                    finish_room_id = find_room(room_vec, args[0], args[1]);
+                    const auto type = packed[square_pos_to_serial_index(x, y, width)];
+                    if (type != 0)
+                    {
+                        parts->emplace_back(x, y, static_cast<SquareType>(type));
+                    }
                 }
             }
-
-            // Finally, convert the square lookup to a vector
-            square_vec = std::vector<MapSquare>(square_lookup.size(), MapSquare(0, 0, SquareType::Unknown));
-            std::transform(square_lookup.cbegin(), square_lookup.cend(), square_vec.begin(), [=](const auto& entry) {
-                const auto pos = serial_index_to_square_pos(entry.first, width);
-                return MapSquare{std::get<0>(pos), std::get<1>(pos), entry.second};
-            });
+            return LevelPartIter<MapSquare>{std::move(parts)};
         }
 
-    private:
-        LevelPartIter<MapSquare> map_squares()
+        LevelPartIter<Room> rooms() const
         {
-            return LevelPartIter<MapSquare>{&square_vec};
+            auto parts = std::make_shared<std::vector<Room>>();
+            parts->reserve(num_rooms);
+            for (size_t i = 0; i < num_rooms; ++i)
+            {
+                const auto room = room_at(i);
+                parts->emplace_back(room.x, room.y, room.w, room.h, room.type, i + 1);
+            }
+            return LevelPartIter<Room>{std::move(parts)};
         }
 
-        LevelPartIter<Room> rooms()
+        LevelPartIter<Door> doors() const
         {
-            return LevelPartIter<Room>{&room_vec};
+            return LevelPartIter<Door>{expand_connections<Door>(doors_offset(), num_doors)};
         }
 
-        LevelPartIter<Door> doors()
+        LevelPartIter<Portal> portals() const
         {
-            return LevelPartIter<Door>{&door_vec};
+            return LevelPartIter<Portal>{expand_connections<Portal>(portals_offset(), num_portals)};
         }
 
-        LevelPartIter<Portal> portals()
+        const uint8_t* grid_squares() const
         {
-            return LevelPartIter<Portal>{&portal_vec};
+            return packed.data();
         }
 
         size_t get_num_map_squares() const
         {
-            return square_vec.size();
+            return num_map_squares;
         }
 
         size_t get_num_corridors() const
@@ -328,17 +535,138 @@ class Level::LevelImpl
 
         size_t get_num_rooms() const
         {
-            return room_vec.size();
+            return num_rooms;
         }
 
         size_t get_num_doors() const
         {
-            return door_vec.size();
+            return num_doors * 2;
         }
 
         size_t get_num_portals() const
         {
-            return portal_vec.size();
+            return num_portals * 2;
+        }
+
+        /// Write the level in the form of the model atoms it was decoded from, rebuilt from its parts. Only the highest
+        /// precedence type of each square is kept, so e.g. room squares are not also listed as ship squares.
+        void write_level_text(std::ostream& out) const
+        {
+            const auto atom = [&](const char* name, std::initializer_list<unsigned> args) {
+                out << " " << name << "(";
+                auto first = true;
+                for (const auto arg : args)
+                {
+                    out << (first ? "" : ",") << arg;
+                    first = false;
+                }
+                out << ")";
+            };
+
+            out << "Level: ";
+            for (auto y = 1U; y <= height; ++y)
+            {
+                for (auto x = 1U; x <= width; ++x)
+                {
+                    // Room and breach squares are written with their rooms, below
+                    switch (static_cast<SquareType>(packed[square_pos_to_serial_index(x, y, width)]))
+                    {
+                        case SquareType::Space:
+                            atom("in_space", {x, y});
+                            break;
+                        case SquareType::Hull:
+                            atom("hull", {x, y});
+                            break;
+                        case SquareType::Ship:
+                            atom("ship", {x, y});
+                            break;
+                        case SquareType::Corridor:
+                            atom("corridor", {x, y});
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < num_rooms; ++i)
+            {
+                const auto room = room_at(i);
+                const auto* square_name = room.type == RoomType::AlienBreach ? "breach_square" : "room_square";
+                if (room.type != RoomType::Corridor)
+                {
+                    for (unsigned y = room.y; y < room.y + room.h; ++y)
+                    {
+                        for (unsigned x = room.x; x < room.x + room.w; ++x)
+                        {
+                            atom(square_name, {x, y, room.x, room.y, room.w, room.h});
+                        }
+                    }
+                }
+
+                if (room.type != RoomType::AlienBreach)
+                {
+                    atom("room", {room.x, room.y, room.w, room.h});
+                    continue;
+                }
+
+                // A breach is connected to the room it breaches by a "door"
+                for (size_t j = 0; j < num_doors; ++j)
+                {
+                    const auto door = door_at(j);
+                    if (door.second_id == i + 1)
+                    {
+                        const auto breached = room_at(door.first_id - 1);
+                        atom("alien_breach", {room.x, room.y, room.w, room.h, breached.x, breached.y});
+                        break;
+                    }
+                }
+            }
+
+            const auto write_connection = [&](const char* name, const PackedConnection& connection) {
+                const auto first = room_at(connection.first_id - 1);
+                const auto second = room_at(connection.second_id - 1);
+                if (first.type != RoomType::AlienBreach && second.type != RoomType::AlienBreach)
+                {
+                    atom(name, {first.x, first.y, second.x, second.y});
+                }
+            };
+            for (size_t i = 0; i < num_doors; ++i)
+            {
+                write_connection("connected", door_at(i));
+            }
+            for (size_t i = 0; i < num_portals; ++i)
+            {
+                write_connection("portal", portal_at(i));
+            }
+
+            if (start_room_id > 0)
+            {
+                const auto start = room_at(start_room_id - 1);
+                atom("start_room", {start.x, start.y});
+            }
+            if (finish_room_id > 0)
+            {
+                const auto finish = room_at(finish_room_id - 1);
+                atom("finish_room", {finish.x, finish.y});
+            }
+        }
+
+        const char* get_level_text()
+        {
+            // Formatted lazily, as this is only needed for debugging. Levels are shared between threads as const, e.g.
+            // by AsyncSolve::best(), so the text is only ever written once.
+            std::call_once(level_text_formatted, [this]() {
+                std::ostringstream out;
+                write_level_text(out);
+                level_text = out.str();
+            });
+            return level_text.c_str();
+        }
+
+        size_t get_memory_size() const
+        {
+            return sizeof(*this) + packed.capacity() + level_text.capacity();
         }
 
         int get_cost() const
@@ -357,19 +685,25 @@ class Level::LevelImpl
         }
 
         const int cost;
-
-        std::vector<MapSquare> square_vec;
-        std::vector<Room> room_vec;
-        std::vector<Door> door_vec;
-        std::vector<Portal> portal_vec;
-
-        size_t num_corridors;
-        size_t num_breaches;
-        size_t start_room_id;
-        size_t finish_room_id;
-
-        const unsigned width;
-        const unsigned height;
+        const uint16_t width;
+        const uint16_t height;
+
+        // Doors and portals are counted one way here
+        const uint16_t num_rooms;
+        const uint16_t num_doors;
+        const uint16_t num_portals;
+        const uint16_t start_room_id;
+        const uint16_t finish_room_id;
+        uint16_t num_corridors = 0;
+        uint16_t num_breaches = 0;
+        uint32_t num_map_squares = 0;
+
+        // The grid squares, then rooms, doors and portals, one way only
+        std::vector<uint8_t> packed;
+
+        // Rebuilt from the packed parts on demand, rather than keeping the model's symbols, which take far more memory
+        std::once_flag level_text_formatted;
+        std::string level_text;
 
         friend class Level;
 };
@@ -380,6 +714,11 @@ LevelPartIter<MapSquare> Level::map_squares() const
     return impl->map_squares();
 }
 
+const uint8_t* Level::grid_squares() const
+{
+    return impl->grid_squares();
+}
+
 LevelPartIter<Room> Level::rooms() const
 {
     return impl->rooms();
@@ -436,6 +775,16 @@ size_t Level::get_num_portals() const
     return impl->get_num_portals();
 }
 
+const char* Level::get_level_text() const
+{
+    return impl->get_level_text();
+}
+
+size_t Level::get_memory_size() const
+{
+    return impl->get_memory_size();
+}
+
 int Level::get_cost() const
 {
     return impl->get_cost();
@@ -451,9 +800,132 @@ unsigned Level::get_height() const
     return impl->get_height();
 }
 
-Level::Level(unsigned width, unsigned height, int64_t cost, const std::vector<uint64_t>& data) : impl(std::make_unique<Level::LevelImpl>(width, height, cost, data))
+Level::Level(unsigned width, unsigned height, int64_t cost, std::vector<uint64_t> data) : impl(std::make_unique<Level::LevelImpl>(width, height, cost, std::move(data)))
+{}
+
+Level::Level(std::unique_ptr<LevelImpl> impl) : impl(std::move(impl))
 {}
 
+std::vector<uint8_t> Level::serialize() const
+{
+    const auto& lvl = *impl;
+    std::vector<uint8_t> out;
+    ByteWriter writer(out);
+
+    // Header
+    writer.write_bytes(reinterpret_cast<const uint8_t*>(level_magic), std::strlen(level_magic));
+    writer.write<uint16_t>(level_format_version);
+    writer.write<uint16_t>(lvl.width);
+    writer.write<uint16_t>(lvl.height);
+    writer.write<int32_t>(lvl.cost);
+    writer.write<uint16_t>(lvl.num_rooms);
+    writer.write<uint16_t>(lvl.num_doors);
+    writer.write<uint16_t>(lvl.num_portals);
+    writer.write<uint16_t>(lvl.start_room_id);
+    writer.write<uint16_t>(lvl.finish_room_id);
+
+    // One byte per grid square
+    writer.write_bytes(lvl.grid_squares(), lvl.rooms_offset());
+
+    // Rooms, in ID order, so their IDs are implicit
+    for (size_t i = 0; i < lvl.num_rooms; ++i)
+    {
+        const auto room = lvl.room_at(i);
+        if (room.w > std::numeric_limits<uint8_t>::max() || room.h > std::numeric_limits<uint8_t>::max())
+        {
+            throw std::runtime_error("level is too large to serialize");
+        }
+        writer.write<uint16_t>(room.x);
+        writer.write<uint16_t>(room.y);
+        writer.write<uint8_t>(static_cast<uint8_t>(room.w));
+        writer.write<uint8_t>(static_cast<uint8_t>(room.h));
+        writer.write<uint8_t>(static_cast<uint8_t>(room.type));
+    }
+
+    // Connections are stored one way, as in memory
+    for (size_t i = 0; i < lvl.num_doors; ++i)
+    {
+        const auto door = lvl.door_at(i);
+        writer.write<uint16_t>(door.first_id);
+        writer.write<uint16_t>(door.second_id);
+    }
+    for (size_t i = 0; i < lvl.num_portals; ++i)
+    {
+        const auto portal = lvl.portal_at(i);
+        writer.write<uint16_t>(portal.first_id);
+        writer.write<uint16_t>(portal.second_id);
+    }
+
+    return out;
+}
+
+std::unique_ptr<Level> Level::deserialize(const uint8_t* data, size_t size)
+{
+    ByteReader reader(data, size);
+
+    reader.expect_magic(level_magic);
+    const auto version = reader.read<uint16_t>();
+    if (version != level_format_version)
+    {
+        throw std::runtime_error("unsupported level format version: " + std::to_string(version));
+    }
+
+    const auto width = reader.read<uint16_t>();
+    const auto height = reader.read<uint16_t>();
+    const auto cost = reader.read<int32_t>();
+    const auto num_rooms = reader.read<uint16_t>();
+    const auto num_doors = reader.read<uint16_t>();
+    const auto num_portals = reader.read<uint16_t>();
+
+    LevelParts parts;
+    parts.start_room_id = reader.read<uint16_t>();
+    parts.finish_room_id = reader.read<uint16_t>();
+
+    const auto check_room_id = [&](uint16_t room_id) {
+        // Room IDs are one-based, so zero is never a valid reference to a room
+        if (room_id == 0 || room_id > num_rooms)
+        {
+            throw std::runtime_error("invalid data: room ID out of range");
+        }
+        return room_id;
+    };
+    check_room_id(static_cast<uint16_t>(parts.start_room_id));
+    check_room_id(static_cast<uint16_t>(parts.finish_room_id));
+
+    const auto* grid = reader.read_bytes(static_cast<size_t>(width) * height);
+    parts.square_grid.assign(grid, grid + static_cast<size_t>(width) * height);
+
+    parts.rooms.reserve(num_rooms);
+    for (auto i = 0U; i < num_rooms; ++i)
+    {
+        const auto x = reader.read<uint16_t>();
+        const auto y = reader.read<uint16_t>();
+        const auto w = reader.read<uint8_t>();
+        const auto h = reader.read<uint8_t>();
+        const auto type = static_cast<RoomType>(reader.read<uint8_t>());
+        parts.rooms.push_back({x, y, w, h, type});
+    }
+
+    const auto read_connections = [&](std::vector<PackedConnection>& connections, size_t num) {
+        connections.reserve(num);
+        for (size_t i = 0; i < num; ++i)
+        {
+            const auto first = check_room_id(reader.read<uint16_t>());
+            const auto second = check_room_id(reader.read<uint16_t>());
+            connections.push_back({first, second});
+        }
+    };
+    read_connections(parts.doors, num_doors);
+    read_connections(parts.portals, num_portals);
+
+    if (reader.remaining() != 0)
+    {
+        throw std::runtime_error("invalid data: unexpected data after level");
+    }
+
+    return std::unique_ptr<Level>(new Level(std::make_unique<LevelImpl>(width, height, cost, std::move(parts))));
+}
+
 Level::Level(Level&& other) noexcept = default;
 
 Level::~Level() = default;
@@ -0,0 +1,164 @@
+#include "level_gen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /// A worker's queue of job indices - the owner takes from the front, other workers steal from the back
+    struct JobQueue
+    {
+        std::deque<size_t> jobs;
+        std::mutex mutex;
+    };
+
+    /// Generators only depend on these params, so can be reused for any job that shares them
+    using GeneratorKey = std::tuple<unsigned, unsigned, unsigned>;
+
+    class BatchRunner
+    {
+        public:
+            BatchRunner(const std::vector<GenParams>& params, unsigned num_workers, unsigned num_threads)
+                : params(params), num_threads(num_threads), queues(std::max(num_workers, 1U)),
+                  results(params.size())
+            {
+                // Group jobs by generator, then hand each worker a contiguous block, so workers mostly reuse a
+                // generator and only steal (and so ground for a new size) once their own block is finished
+                std::vector<size_t> order(params.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](size_t left, size_t right)
+                {
+                    return key(params[left]) < key(params[right]);
+                });
+
+                const auto block_size = (order.size() + queues.size() - 1) / queues.size();
+                for (size_t i = 0; i < order.size(); ++i)
+                {
+                    queues[i / block_size].jobs.push_back(order[i]);
+                }
+            }
+
+            std::vector<std::unique_ptr<Level>> run()
+            {
+                std::vector<std::thread> workers;
+                for (size_t i = 0; i < queues.size(); ++i)
+                {
+                    workers.emplace_back([this, i]() { work(i); });
+                }
+                for (auto& worker : workers)
+                {
+                    worker.join();
+                }
+                if (worker_error)
+                {
+                    std::rethrow_exception(worker_error);
+                }
+                return std::move(results);
+            }
+
+        private:
+            const std::vector<GenParams>& params;
+            const unsigned num_threads;
+            std::vector<JobQueue> queues;
+            std::vector<std::unique_ptr<Level>> results;  // Each result is only written by the worker that ran it
+            std::exception_ptr worker_error;  // The first error from any job, which stops the whole batch
+            std::atomic<bool> failed{false};
+            std::mutex error_mutex;
+
+            static GeneratorKey key(const GenParams& job)
+            {
+                return std::make_tuple(job.width, job.height, job.max_num_levels);
+            }
+
+            bool take_own(size_t worker, size_t& job)
+            {
+                auto& queue = queues[worker];
+                std::lock_guard<std::mutex> guard(queue.mutex);
+                if (queue.jobs.empty())
+                {
+                    return false;
+                }
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                return true;
+            }
+
+            bool steal(size_t worker, size_t& job)
+            {
+                for (size_t offset = 1; offset < queues.size(); ++offset)
+                {
+                    auto& queue = queues[(worker + offset) % queues.size()];
+                    std::lock_guard<std::mutex> guard(queue.mutex);
+                    if (!queue.jobs.empty())
+                    {
+                        job = queue.jobs.back();
+                        queue.jobs.pop_back();
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// Worker loop - run jobs until every queue is empty, or any job fails. No jobs are added once running, so
+            /// an empty sweep means the batch is done.
+            void work(size_t worker)
+            {
+                std::map<GeneratorKey, std::unique_ptr<LevelGenerator>> generators;
+                size_t job;
+                while (!failed && (take_own(worker, job) || steal(worker, job)))
+                {
+                    const auto& job_params = params[job];
+                    auto& gen = generators[key(job_params)];
+                    try
+                    {
+                        if (!gen)
+                        {
+                            gen = std::make_unique<LevelGenerator>(
+                                    job_params.max_num_levels, job_params.width, job_params.height,
+                                    job_params.min_rooms, job_params.max_rooms, job_params.num_breaches,
+                                    job_params.num_portals, job_params.seed, false, num_threads);
+                        }
+                        else
+                        {
+                            gen->set_inputs(job_params.min_rooms, job_params.max_rooms, job_params.num_breaches,
+                                            job_params.num_portals, job_params.seed);
+                        }
+
+                        gen->solve();
+                        results[job] = take_best_level(*gen);
+                    }
+                    catch (const std::exception&)
+                    {
+                        std::lock_guard<std::mutex> guard(error_mutex);
+                        if (!worker_error)
+                        {
+                            worker_error = std::current_exception();
+                        }
+                        failed = true;
+                    }
+                }
+            }
+    };
+}
+
+std::vector<std::unique_ptr<Level>> generate_batch(const std::vector<GenParams>& params, unsigned num_workers,
+                                                   unsigned num_threads)
+{
+    if (params.empty())
+    {
+        return {};
+    }
+
+    BatchRunner runner(params, num_workers, num_threads);
+    return runner.run();
+}
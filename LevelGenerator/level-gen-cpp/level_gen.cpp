@@ -1,7 +1,16 @@
 #include "level_gen.h"
 #include "program.h"
+#include "pregrounded.h"
+#include "solver_config.h"
+#include "ship_geometry.h"
+#include "aspif.h"
 #include "clingo.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <initializer_list>
 #include <memory>
 #include <sstream>
 #include <fstream>
@@ -9,8 +18,43 @@
 #include <random>
 #include <utility>
 #include <mutex>
+#include <stdexcept>
 
 namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /// Look up a value in clingo's statistics tree, or 0 if it is not present, e.g. when nothing was solved
+    uint64_t stat_value(Clingo::Statistics stats, std::initializer_list<const char*> path)
+    {
+        for (const auto* key : path)
+        {
+            if (!stats.has_subkey(key))
+            {
+                return 0;
+            }
+            stats = stats[key];
+        }
+        return static_cast<uint64_t>(stats.value());
+    }
+
+    /// The ground program built in for a grid size, or nullptr if it must be grounded at runtime
+    const char* find_pregrounded(unsigned width, unsigned height)
+    {
+        for (const auto* entry = pregrounded_programs; entry->aspif; ++entry)
+        {
+            if (entry->width == width && entry->height == height)
+            {
+                return entry->aspif;
+            }
+        }
+        return nullptr;
+    }
+
     class CancelableSolveHandler : public Clingo::SolveEventHandler
     {
         public:
@@ -29,65 +73,121 @@ namespace {
 }
 
 
+class CancelToken::CancelTokenImpl
+{
+    public:
+        std::atomic<bool> cancelled{false};
+
+        void cancel()
+        {
+            cancelled = true;
+
+            std::lock_guard<std::mutex> guard(mutex);
+            for (auto* solver : searching)
+            {
+                solver->interrupt();
+            }
+        }
+
+        /// Interrupts a solver's search if the token is cancelled, for as long as the guard exists
+        class SearchGuard
+        {
+            public:
+                SearchGuard(CancelTokenImpl& token, Clingo::Control& solver) : token(token), solver(&solver)
+                {
+                    std::lock_guard<std::mutex> guard(token.mutex);
+                    token.searching.push_back(this->solver);
+                }
+
+                ~SearchGuard()
+                {
+                    // Blocks while the token is interrupting, so the solver is never interrupted once this is gone
+                    std::lock_guard<std::mutex> guard(token.mutex);
+                    token.searching.erase(std::find(token.searching.begin(), token.searching.end(), solver));
+                }
+
+                SearchGuard(const SearchGuard& other) = delete;
+                SearchGuard& operator=(const SearchGuard& other) = delete;
+
+            private:
+                CancelTokenImpl& token;
+                Clingo::Control* solver;
+        };
+
+    private:
+        std::mutex mutex;
+        std::vector<Clingo::Control*> searching;  // The same token can cancel any number of solves
+};
+
+CancelToken::CancelToken() : impl(std::make_unique<CancelTokenImpl>())
+{}
+
+CancelToken::~CancelToken() = default;
+
+void CancelToken::cancel()
+{
+    impl->cancel();
+}
+
+bool CancelToken::is_cancelled() const
+{
+    return impl->cancelled;
+}
+
+void CancelToken::reset()
+{
+    impl->cancelled = false;
+}
+
 class LevelGenerator::LevelGenImpl
 {
     public:
         LevelGenImpl(unsigned max_num_levels, unsigned width, unsigned height, unsigned min_rooms, unsigned max_rooms,
-                unsigned num_breaches, unsigned num_portals, size_t seed, bool load_prog_from_file, unsigned num_threads)
-                 : width(width), height(height), min_rooms(min_rooms), max_rooms(max_rooms), num_breaches(num_breaches),
-                 num_portals(num_portals), solver(std::make_unique<Clingo::Control>())
+                unsigned num_breaches, unsigned num_portals, size_t seed, bool load_prog_from_file, unsigned num_threads,
+                ParallelMode parallel_mode, const char* portfolio_path, const char* config_path,
+                const ConfigMap& config_overrides)
+                 : max_num_levels(max_num_levels), width(width), height(height), min_rooms(min_rooms),
+                 max_rooms(max_rooms), num_breaches(num_breaches), num_portals(num_portals), seed(seed),
+                 solver(std::make_unique<Clingo::Control>())
         {
+            SolverConfig entries;
+            if (config_path)
+            {
+                config_profile = "file";
+                entries = read_config_file(config_path);
+            }
+            else
+            {
+                config_profile = "default";
+                entries = parse_solver_config(tuned_config);
+            }
+
             auto config = solver->configuration();
-            config["configuration"] = "jumpy";  // Fast base config
-
-            // Performance tuning params generated by piclasp
-            config["learn_explicit"] = "1";
-            config["sat_prepro"] = "no";
-            config["asp.trans_ext"] = "integ";
-            config["asp.eq"] = "0";
-            config["asp.backprop"] = "1";
-            config["asp.no_gamma"] = "1";
-            config["solver.lookahead"] = "no";
-            config["solver.heuristic"] = "Vsids,94";
-            config["solver.init_moms"] = "1";
-            config["solver.score_res"] = "multiset";
-            config["solver.score_other"] = "no";
-            config["solver.sign_def"] = "pos";
-            config["solver.save_progress"] = "115";
-            config["solver.init_watches"] = "first";
-            config["solver.partial_check"] = "30";
-            config["solver.deletion"] = "ipHeap,30,lbd";
-            config["solver.del_cfl"] = "F,55";
-            config["solver.del_grow"] = "1.9111,94.6281";
-            config["solver.del_glue"] = "4,1";
-            config["solver.del_init"] = "30.3279,19,12774";
-            config["solver.del_estimate"] = "2";
-            config["solver.del_max"] = "1803231815";
-            config["solver.del_on_restart"] = "4";
-            config["solver.local_restarts"] = "1";
-            config["solver.strengthen"] = "recursive,all";
-            config["solver.restarts"] = "no";
-            config["solver.contraction"] = "no";
-            config["solver.loops"] = "shared";
-            config["solver.otfs"] = "1";
-            config["solver.reverse_arcs"] = "2";
-            config["solver.update_lbd"] = "0";
+            if (parallel_mode == ParallelMode::Compete)
+            {
+                set_portfolio_config(config, portfolio_path);
+            }
+            apply_config(config, entries, parallel_mode != ParallelMode::Compete);
 
             // Input config
             if (num_threads >= 1)
             {
-                // Split problem-solving between threads
-                config["solve.parallel_mode"] = (std::to_string(num_threads) + ",split").c_str();
+                // Either split problem-solving between threads, or have them race, where the first model found by any
+                // thread is reported, and every thread then only searches for better ones
+                const auto mode = parallel_mode == ParallelMode::Compete ? ",compete" : ",split";
+                config["solve.parallel_mode"] = (std::to_string(num_threads) + mode).c_str();
             }
 
             // Note - this is the upper limit, the solver may stop if an optimum is found
             config["solve.models"] = std::to_string(max_num_levels).c_str();
-            if (seed == 0)
+            config["solver.rand_freq"] = "1.0";  // Always choose randomly where possible
+            config["stats"] = "1";  // Collect the search statistics returned by get_stats()
+
+            // Caller overrides come last, so they take priority over everything else
+            for (const auto& entry : config_overrides)
             {
-                seed = std::random_device()();
+                config[entry.first.c_str()] = entry.second.c_str();
             }
-            config["solver.seed"] = std::to_string(seed).c_str();
-            config["solver.rand_freq"] = "1.0";  // Always choose randomly where possible
 
             if (!load_prog_from_file)
             {
@@ -99,19 +199,87 @@ class LevelGenerator::LevelGenImpl
 
     private:
         std::unique_ptr<Clingo::Control> solver;
-        std::vector<Level> levels;
+        // Each level is allocated separately, so levels stay put while a background solve adds more
+        std::vector<std::unique_ptr<Level>> levels;
+        // Levels dropped by the limit on levels kept, which are only freed on the next solve, as the caller can still
+        // hold a pointer to one, e.g. from AsyncSolve::best() while a background solve replaces it
+        std::vector<std::unique_ptr<Level>> dropped;
+        Level* best = nullptr;
+        size_t num_found = 0;  // Including levels that were not kept
+        size_t max_kept = 0;  // Zero for no limit
         std::string solutions;
 
+        const unsigned max_num_levels;
         const unsigned width;
         const unsigned height;
-        const unsigned min_rooms;
-        const unsigned max_rooms;
-        const unsigned num_breaches;
-        const unsigned num_portals;
+        unsigned min_rooms;
+        unsigned max_rooms;
+        unsigned num_breaches;
+        unsigned num_portals;
+        size_t seed;
         std::string program;
+        const char* config_profile;
+
+        OptMode opt_mode = OptMode::Improve;
+        level_cb on_level = nullptr;
+        bool dump_models = false;
+
+        bool grounded = false;
+        bool pregrounded = false;  // Whether the ground program was loaded from the build, rather than grounded
+        std::vector<Clingo::literal_t> assigned_inputs;
+
+        GenStats stats;
+        uint64_t ground_atoms = 0;
+        uint64_t ground_rules = 0;
 
         mutable std::mutex level_mutex;
 
+        static SolverConfig read_config_file(const char* config_path)
+        {
+            std::ifstream file(config_path);
+            if (!file.is_open())
+            {
+                throw std::exception((std::string("failed to read solver config: ") + config_path).c_str());
+            }
+            return parse_solver_config(file);
+        }
+
+        /// Apply a solver configuration, skipping per-solver keys if each solver is configured separately
+        static void apply_config(Clingo::Configuration& config, const SolverConfig& entries, bool per_solver)
+        {
+            for (const auto& entry : entries)
+            {
+                if (per_solver || !is_per_solver_key(entry.first))
+                {
+                    config[entry.first.c_str()] = entry.second.c_str();
+                }
+            }
+        }
+
+        /// Give each thread its own configuration from a portfolio. Any per-solver options set after this would be
+        /// applied to every configuration in the portfolio, so only the global tuned params should be.
+        static void set_portfolio_config(Clingo::Configuration& config, const char* portfolio_path)
+        {
+            if (portfolio_path)
+            {
+                // clasp only reads the file when solving starts, so check it up front for a clearer error
+                std::ifstream portfolio(portfolio_path);
+                if (!portfolio.is_open())
+                {
+                    throw std::exception(
+                        (std::string("failed to read solver portfolio: ") + portfolio_path).c_str()
+                    );
+                }
+                config["configuration"] = portfolio_path;
+            }
+            else
+            {
+                // clasp's default portfolio, which is built into clingo - the same as
+                // level-gen-python/clingo/portfolio.txt
+                config["configuration"] = "many";
+            }
+        }
+
         void add_program_from_file(const char *path)
         {
             // Load from file
@@ -149,8 +317,26 @@ class LevelGenerator::LevelGenImpl
             }
         }
 
-        const char* solve(std::function<bool(void)> check_cancel)
+        /// Add and ground the program - this only depends on the grid size, so is done once per generator
+        void ground()
         {
+            const auto parse_start = Clock::now();
+
+            // The build can include the embedded program already grounded for standard sizes - a program loaded from
+            // file may differ from it, so is always grounded
+            const auto* aspif = program.empty() ? nullptr : find_pregrounded(width, height);
+            if (aspif)
+            {
+                AspifReader(*solver, aspif).read();
+                grounded = true;
+                pregrounded = true;
+
+                std::lock_guard<std::mutex> guard(level_mutex);
+                stats.parse_time = seconds_since(parse_start);
+                stats.ground_time = 0.0;
+                return;
+            }
+
             if (program.empty())
             {
                 add_program_from_file("programs/ship.lp");
@@ -162,7 +348,7 @@ class LevelGenerator::LevelGenImpl
                 solver->add("base", {}, program.c_str());
             }
 
-            // Add inputs
+            // Add inputs - the other inputs are externals, assigned before each solve
             std::stringstream inputs;
             inputs
                     << "#const width = "
@@ -172,77 +358,563 @@ class LevelGenerator::LevelGenImpl
                     << "#const height = "
                     << Clingo::Number(static_cast<int>(height))
                     << "."
-                    << std::endl
-                    << "#const min_rooms = "
-                    << Clingo::Number(static_cast<int>(min_rooms))
-                    << "."
-                    << std::endl
-                    << "#const max_rooms = "
-                    << Clingo::Number(static_cast<int>(max_rooms))
-                    << "."
-                    << std::endl
-                    << "#const num_breaches = "
-                    << Clingo::Number(static_cast<int>(num_breaches))
-                    << "."
-                    << std::endl
-                    << "#const num_portals = "
-                    << Clingo::Number(static_cast<int>(num_portals))
-                    << "."
                     << std::endl;
             solver->add("base", {}, inputs.str().c_str());
 
+            // The ship's geometry only depends on the grid size, so is worked out here, rather than grounding the rules
+            // in geometry.lp, which is much slower on large grids
+            solver->add("base", {}, ShipGeometry(width, height).facts().c_str());
+            const auto parse_time = seconds_since(parse_start);
+
+            const auto ground_start = Clock::now();
             solver->ground({{"base", {}}});
+            const auto ground_time = seconds_since(ground_start);
+            grounded = true;
 
+            std::lock_guard<std::mutex> guard(level_mutex);
+            stats.parse_time = parse_time;
+            stats.ground_time = ground_time;
+        }
+
+        /// Set an input external to true, returning false if it does not exist, i.e. the value can never be met
+        bool assign_input(const char* name, unsigned value)
+        {
+            const auto input = Clingo::Function(name, {Clingo::Number(static_cast<int>(value))});
+            const auto atoms = solver->symbolic_atoms();
+            const auto found = atoms.find(input);
+            if (found == atoms.end())
+            {
+                return false;
+            }
+
+            // Assigned by literal, as a pregrounded program's externals are only declared through the backend
+            solver->assign_external(found->literal(), Clingo::TruthValue::True);
+            assigned_inputs.push_back(found->literal());
+            return true;
+        }
+
+        /// Assign the externals for the current inputs, returning false if they can never be satisfied
+        bool assign_inputs()
+        {
+            // Reset the inputs from any previous solve
+            for (const auto& input : assigned_inputs)
+            {
+                solver->assign_external(input, Clingo::TruthValue::False);
+            }
+            assigned_inputs.clear();
+
+            // max_rooms is an upper bound, so if it is out of range it is simply left unbounded
+            assign_input("max_rooms", max_rooms);
+
+            return assign_input("min_rooms", min_rooms)
+                   && assign_input("num_breaches", num_breaches)
+                   && assign_input("num_portals", num_portals);
+        }
+
+        void set_inputs(unsigned new_min_rooms, unsigned new_max_rooms, unsigned new_num_breaches,
+                        unsigned new_num_portals, size_t new_seed)
+        {
+            min_rooms = new_min_rooms;
+            max_rooms = new_max_rooms;
+            num_breaches = new_num_breaches;
+            num_portals = new_num_portals;
+            seed = new_seed;
+        }
+
+        void set_opt_mode(OptMode mode, int max_cost)
+        {
+            // Note each improving model counts towards solve.models, so a limit of 1 stops at the first model found
+            std::string clingo_mode = "opt";
+            auto num_models = 1U;
+            switch (mode)
+            {
+                case OptMode::Improve:
+                    num_models = max_num_levels;
+                    break;
+                case OptMode::FirstFeasible:
+                    break;
+                case OptMode::CostBound:
+                    // Every model found must cost at most the bound, so the first one found is good enough
+                    clingo_mode += "," + std::to_string(max_cost);
+                    break;
+                case OptMode::ProveOptimal:
+                    num_models = 0;
+                    break;
+                case OptMode::EnumerateOptimal:
+                    // Find the optimum, then enumerate models with the same cost
+                    clingo_mode = "optN";
+                    num_models = max_num_levels;
+                    break;
+            }
+
+            auto config = solver->configuration();
+            config["solve.opt_mode"] = clingo_mode.c_str();
+            config["solve.models"] = std::to_string(num_models).c_str();
+            opt_mode = mode;
+        }
+
+        void set_max_kept_levels(size_t max_levels)
+        {
+            std::lock_guard<std::mutex> guard(level_mutex);
+            max_kept = max_levels;
+            while (max_kept > 0 && levels.size() > max_kept)
+            {
+                drop_worst_level();
+            }
+        }
+
+        void set_level_callback(level_cb callback)
+        {
+            on_level = callback;
+        }
+
+        void set_dump_models(bool dump)
+        {
+            dump_models = dump;
+        }
+
+        /// State for a single call to solve
+        struct SolveState
+        {
             std::ostringstream out;
+            GenStats stats;
+            bool optimality_proven = false;
+            const Clock::time_point start = Clock::now();
+        };
+
+        /// Reset the levels and inputs for a new solve, grounding first if needed. Returns false if no level can exist
+        /// with the current inputs, so there is no need to search, or the token was cancelled before the search.
+        bool prepare_solve(const CancelToken::CancelTokenImpl* token = nullptr)
+        {
+            // Only one search can run at a time
+            cancel_async();
+
+            {
+                std::lock_guard<std::mutex> guard(level_mutex);
+                levels.clear();
+                dropped.clear();
+                best = nullptr;
+                num_found = 0;
+                stats = GenStats{};
+            }
+
+            if (!grounded)
+            {
+                // Grounding can take seconds on large grids, and clingo cannot interrupt it, so check either side
+                if (token && token->cancelled)
+                {
+                    return false;
+                }
+                ground();
+            }
+
+            solutions.clear();
+
+            if (token && token->cancelled)
+            {
+                return false;
+            }
+
+            if (!assign_inputs())
+            {
+                return false;
+            }
+
+            // A zero seed means "unset", so pick a new random one for every solve
+            const auto solve_seed = seed == 0 ? std::random_device()() : seed;
+            solver->configuration()["solver.seed"] = std::to_string(solve_seed).c_str();
+            return true;
+        }
+
+        /// Write the symbols of a model as clingo shows them, apart from the inputs, which are only shown when the
+        /// program was pregrounded, as their names are kept so they can be assigned
+        void write_model(const Clingo::Model& m, std::ostream& out) const
+        {
+            out << "Model: ";
+            for (const auto& symbol : m.symbols())
+            {
+                if (!pregrounded || !is_input(symbol))
+                {
+                    out << " " << symbol;
+                }
+            }
+            out << std::endl;
+        }
+
+        static bool is_input(const Clingo::Symbol& symbol)
+        {
+            if (symbol.type() != Clingo::SymbolType::Function || symbol.arguments().size() != 1)
+            {
+                return false;
+            }
+            const auto* name = symbol.name();
+            return std::strcmp(name, "min_rooms") == 0 || std::strcmp(name, "max_rooms") == 0
+                   || std::strcmp(name, "num_breaches") == 0 || std::strcmp(name, "num_portals") == 0;
+        }
+
+        /// Decode a model into a new level, and report it
+        void add_model(const Clingo::Model& m, SolveState& state)
+        {
+            // clingo also reports the improving models found on the way to the optimum
+            if (opt_mode == OptMode::EnumerateOptimal && !m.optimality_proven())
+            {
+                return;
+            }
+
+            const auto costs = m.cost();
+            const auto total_cost = std::accumulate(costs.cbegin(), costs.cend(), (decltype(costs)::value_type) 0);
+
+            // Every model is dumped, even those not kept, as clingo reported them
+            if (dump_models)
+            {
+                write_model(m, state.out);
+            }
+
+            size_t index;
+            {
+                std::lock_guard<std::mutex> guard(level_mutex);
+                index = num_found++;
+                if (!should_keep(total_cost))
+                {
+                    return;  // Not worth decoding, as it would be dropped straight away
+                }
+            }
+
+            const auto model_symbols = m.symbols();
+            std::vector<clingo_symbol_t> transformed_symbols(model_symbols.size(), (clingo_symbol_t) 0);
+            std::transform(model_symbols.cbegin(), model_symbols.cend(), transformed_symbols.begin(),
+                           [](const auto& sym) { return sym.to_c(); });
+            const auto decode_start = Clock::now();
+            auto new_level = std::make_unique<Level>(width, height, total_cost, std::move(transformed_symbols));
+            state.stats.decode_time += seconds_since(decode_start);
+
+            const Level* level = new_level.get();
+            {
+                std::lock_guard<std::mutex> guard(level_mutex);
+                keep_level(std::move(new_level));
+            }
 
+            // Each model improves on the last, so the latest one is always the best so far
+            state.stats.best_model_time = seconds_since(state.start);
+            if (index == 0)
+            {
+                state.stats.first_model_time = state.stats.best_model_time;
+            }
+            state.optimality_proven = m.optimality_proven();
+
+            // Called outside the lock, so the callback is free to query the generator. Only this thread adds, and so
+            // drops, levels, so the level cannot go away while the callback runs.
+            if (on_level)
+            {
+                on_level(*level, level->get_cost(), index);
+            }
+        }
+
+        /// Whether a level with this cost would be among the best kept so far - call with the level mutex held
+        bool should_keep(int64_t cost) const
+        {
+            if (max_kept == 0 || levels.size() < max_kept)
+            {
+                return true;
+            }
+            return cost <= worst_level()->get()->get_cost();
+        }
+
+        /// Call with the level mutex held
+        std::vector<std::unique_ptr<Level>>::const_iterator worst_level() const
+        {
+            // The oldest of equally bad levels, as later levels are preferred on a tie
+            return std::max_element(levels.cbegin(), levels.cend(), [](const auto& left, const auto& right) {
+                return left->get_cost() < right->get_cost();
+            });
+        }
+
+        /// Add a level worth keeping, dropping the worst level if there are too many - call with the level mutex held
+        void keep_level(std::unique_ptr<Level> level)
+        {
+            if (max_kept > 0 && levels.size() >= max_kept)
+            {
+                drop_worst_level();
+            }
+
+            // On a tie the latest level is the best, just as the oldest is the worst
+            if (!best || level->get_cost() <= best->get_cost())
+            {
+                best = level.get();
+            }
+            levels.push_back(std::move(level));
+        }
+
+        /// Call with the level mutex held
+        void drop_worst_level()
+        {
+            const auto worst = levels.begin() + (worst_level() - levels.cbegin());
+            if (worst->get() == best)
+            {
+                best = nullptr;  // Only when keeping a single level, which a new level is about to replace
+            }
+            dropped.push_back(std::move(*worst));
+            levels.erase(worst);
+        }
+
+        void finish_solve(SolveState& state)
+        {
+            state.stats.solve_time = seconds_since(state.start);
+            record_stats(state.stats, state.optimality_proven);
+            solutions = state.out.str();
+        }
+
+        /// Decodes each model as soon as it is found, on the solver's thread, so the search never waits for the caller
+        /// to collect models
+        class AsyncModelHandler : public Clingo::SolveEventHandler
+        {
+            public:
+                AsyncModelHandler(LevelGenImpl& gen, SolveState& state) : gen(gen), state(state) {}
+
+                bool on_model(Clingo::Model& model) override
+                {
+                    gen.add_model(model, state);
+                    return true;
+                }
+
+            private:
+                LevelGenImpl& gen;
+                SolveState& state;
+        };
+
+        // The state of the current background solve, if any - the handle comes last, so it is closed first, stopping
+        // the search before the rest is destroyed
+        std::unique_ptr<SolveState> async_state;
+        std::unique_ptr<AsyncModelHandler> async_handler;
+        std::unique_ptr<Clingo::SolveHandle> async_handle;
+        std::unique_ptr<AsyncSolve> async_solve;  // Handed to the caller, and reused for every background solve
+
+        void solve_async()
+        {
+            if (!prepare_solve())
+            {
+                return;  // No level can exist with these inputs, so the solve is already finished
+            }
+
+            async_state = std::make_unique<SolveState>();
+            async_handler = std::make_unique<AsyncModelHandler>(*this, *async_state);
+            async_handle = std::make_unique<Clingo::SolveHandle>(
+                    solver->solve(Clingo::LiteralSpan{}, async_handler.get(), true, false));
+        }
+
+        /// Wait up to timeout seconds for the background solve to finish, returning whether it has
+        bool wait_async(double timeout)
+        {
+            if (!async_handle)
+            {
+                return true;
+            }
+            if (!async_handle->wait(timeout))
+            {
+                return false;
+            }
+            end_async();
+            return true;
+        }
+
+        void cancel_async()
+        {
+            if (async_handle)
+            {
+                async_handle->cancel();
+                end_async();
+            }
+        }
+
+        /// Tidy up after a finished background solve, ready for the next one
+        void end_async()
+        {
+            // Released up front, so the generator can still solve again if the search failed
+            auto state = std::move(async_state);
+            auto handler = std::move(async_handler);
+            auto handle = std::move(async_handle);
+
+            handle->get();  // Rethrows any error from the search
+            handle.reset();  // clingo only allows one open solve at a time
+            finish_solve(*state);
+        }
+
+        const char* solve(std::function<bool(void)> check_cancel)
+        {
+            if (!prepare_solve())
+            {
+                return solutions.c_str();  // No level can exist with these inputs
+            }
+
+            return search(check_cancel);
+        }
+
+        const char* solve(CancelToken::CancelTokenImpl& token, const std::function<bool(void)>& check_cancel = nullptr)
+        {
+            if (!prepare_solve(&token))
+            {
+                return solutions.c_str();  // No level can exist with these inputs, or the solve was cancelled
+            }
+
+            return search([&]() { return token.cancelled || (check_cancel && check_cancel()); }, &token);
+        }
+
+        /// Search for levels after prepare_solve(), stopping early if check_cancel returns true, or straight away if
+        /// the token, if any, is cancelled
+        const char* search(const std::function<bool(void)>& check_cancel,
+                           CancelToken::CancelTokenImpl* token = nullptr)
+        {
+            SolveState state;
             std::unique_ptr<CancelableSolveHandler> event_handler = std::make_unique<CancelableSolveHandler>(
                     [&](){ return check_cancel && check_cancel(); });
-            for (const auto& m : solver->solve(Clingo::LiteralSpan{}, event_handler.get()))
             {
-                const auto costs = m.cost();
-                const auto total_cost = std::accumulate(costs.cbegin(), costs.cend(), (decltype(costs)::value_type) 0);
+                auto handle = solver->solve(Clingo::LiteralSpan{}, event_handler.get());
 
-                const auto model_symbols = m.symbols();
-                std::vector<clingo_symbol_t> transformed_symbols(model_symbols.size(), (clingo_symbol_t) 0);
-                std::transform(model_symbols.cbegin(), model_symbols.cend(), transformed_symbols.begin(),
-                               [](const auto& sym) { return sym.to_c(); });
-                out << "Model: ";
-                for (auto& atom : m.symbols())
+                // The guard is released before the handle is closed, as an interrupt with no open search would carry
+                // over to the next one. A cancel just before the guard is taken is caught by the check after it.
+                std::unique_ptr<CancelToken::CancelTokenImpl::SearchGuard> guard;
+                if (token)
                 {
-                    out << " " << atom;
+                    guard = std::make_unique<CancelToken::CancelTokenImpl::SearchGuard>(*token, *solver);
                 }
-                out << std::endl;
-                std::lock_guard<std::mutex> guard(level_mutex);
-                levels.emplace_back(width, height, total_cost, transformed_symbols);
 
-                if (check_cancel && check_cancel()) break;
+                if (!token || !token->cancelled)
+                {
+                    for (const auto& m : handle)
+                    {
+                        add_model(m, state);
+
+                        if (check_cancel && check_cancel()) break;
+                    }
+                }
             }
-            solutions = out.str();
+            finish_solve(state);
             return solutions.c_str();
         }
 
+        TimedSolveResult solve_for(std::chrono::milliseconds budget)
+        {
+            const auto deadline = Clock::now() + budget;
+            TimedSolveResult result{nullptr, false, false};
+            if (!prepare_solve())
+            {
+                return result;  // No level can exist with these inputs
+            }
+
+            SolveState state;
+            {
+                // Solve in the background, so every wait for a model is bounded by the deadline, even when the solver
+                // goes a long time without finding one
+                auto handle = solver->solve(Clingo::LiteralSpan{}, nullptr, true, true);
+                while (true)
+                {
+                    const auto remaining = std::chrono::duration<double>(deadline - Clock::now()).count();
+                    if (!handle.wait(std::max(remaining, 0.0)))
+                    {
+                        handle.cancel();
+                        result.timed_out = true;
+                        break;
+                    }
+
+                    const clingo_model_t* model = nullptr;
+                    if (!clingo_solve_handle_model(handle.to_c(), &model))
+                    {
+                        throw std::runtime_error(clingo_error_message());
+                    }
+                    if (!model)
+                    {
+                        break;  // The search is finished
+                    }
+
+                    add_model(Clingo::Model(const_cast<clingo_model_t*>(model)), state);
+                    handle.resume();
+                }
+            }
+            finish_solve(state);
+
+            result.level = best_level();
+            result.optimality_proven = state.stats.optimality_proven;
+            return result;
+        }
+
+        /// Fill in the rest of the stats for a finished solve from clingo's statistics tree
+        void record_stats(GenStats& solve_stats, bool optimality_proven)
+        {
+            const auto clingo_stats = solver->statistics();
+            solve_stats.num_choices = stat_value(clingo_stats, {"solving", "solvers", "choices"});
+            solve_stats.num_conflicts = stat_value(clingo_stats, {"solving", "solvers", "conflicts"});
+            solve_stats.num_restarts = stat_value(clingo_stats, {"solving", "solvers", "restarts"});
+            solve_stats.num_models = stat_value(clingo_stats, {"summary", "models", "enumerated"});
+
+            // The optimum is proven either when a model is reported as optimal, or the search finished without
+            // finding anything better than the last model
+            solve_stats.optimality_proven =
+                    optimality_proven || stat_value(clingo_stats, {"summary", "models", "optimal"}) > 0;
+
+            std::lock_guard<std::mutex> guard(level_mutex);
+            solve_stats.parse_time = stats.parse_time;
+            solve_stats.ground_time = stats.ground_time;
+            solve_stats.pregrounded = pregrounded;
+
+            // The program is only grounded once, so its size is only reported for the step that grounded it
+            const auto num_atoms = stat_value(clingo_stats, {"problem", "lp", "atoms"});
+            const auto num_rules = stat_value(clingo_stats, {"problem", "lp", "rules"});
+            solve_stats.num_atoms = num_atoms > 0 ? num_atoms : ground_atoms;
+            solve_stats.num_rules = num_rules > 0 ? num_rules : ground_rules;
+            ground_atoms = solve_stats.num_atoms;
+            ground_rules = solve_stats.num_rules;
+
+            stats = solve_stats;
+        }
+
+        const char* get_config_profile() const
+        {
+            return config_profile;
+        }
+
+        GenStats get_stats() const
+        {
+            std::lock_guard<std::mutex> guard(level_mutex);
+            return stats;
+        }
+
         bool has_level() const
         {
             std::lock_guard<std::mutex> guard(level_mutex);
-            return !levels.empty();
+            return best != nullptr;
         }
 
         Level* best_level()
         {
             std::lock_guard<std::mutex> guard(level_mutex);
-            if (levels.empty())
+            return best;
+        }
+
+        /// Remove the best level from those kept, so it can outlive the next solve
+        std::unique_ptr<Level> take_best()
+        {
+            std::lock_guard<std::mutex> guard(level_mutex);
+            if (!best)
             {
                 return nullptr;
             }
 
-            return &(*std::min_element(
-                levels.begin(),
-                levels.end(),
-                [&](const auto& left, const auto& right)
+            const auto taken = std::find_if(levels.begin(), levels.end(), [this](const auto& level) {
+                return level.get() == best;
+            });
+            auto level = std::move(*taken);
+            levels.erase(taken);
+
+            // The latest of the cheapest levels left, as keep_level() would have chosen
+            best = nullptr;
+            for (const auto& left : levels)
+            {
+                if (!best || left->get_cost() <= best->get_cost())
                 {
-                    return left.get_cost() <= right.get_cost();
+                    best = left.get();
                 }
-            ));
+            }
+            return level;
         }
 
         size_t num_levels() const
@@ -251,6 +923,12 @@ class LevelGenerator::LevelGenImpl
             return levels.size();
         }
 
+        size_t num_levels_found() const
+        {
+            std::lock_guard<std::mutex> guard(level_mutex);
+            return num_found;
+        }
+
         void interrupt()
         {
             solver->interrupt();
@@ -267,13 +945,66 @@ class LevelGenerator::LevelGenImpl
         }
 
         friend class LevelGenerator;
+        friend class AsyncSolve;
+        friend std::unique_ptr<Level> take_best_level(LevelGenerator& gen);
 };
 
+class AsyncSolve::AsyncSolveImpl
+{
+    public:
+        explicit AsyncSolveImpl(LevelGenerator::LevelGenImpl& gen) : gen(gen) {}
+
+    private:
+        LevelGenerator::LevelGenImpl& gen;
+
+        friend class AsyncSolve;
+};
+
+AsyncSolve::AsyncSolve(std::unique_ptr<AsyncSolveImpl> impl) : impl(std::move(impl))
+{}
+
+AsyncSolve::~AsyncSolve() = default;
+
+bool AsyncSolve::poll()
+{
+    return impl->gen.wait_async(0.0);
+}
+
+bool AsyncSolve::wait(unsigned timeout_ms)
+{
+    return impl->gen.wait_async(timeout_ms / 1000.0);
+}
+
+void AsyncSolve::cancel()
+{
+    impl->gen.cancel_async();
+}
+
+size_t AsyncSolve::models_so_far() const
+{
+    return impl->gen.num_levels_found();
+}
+
+Level* AsyncSolve::best()
+{
+    return impl->gen.best_level();
+}
+
 LevelGenerator::LevelGenerator(unsigned max_num_levels, unsigned width, unsigned height, unsigned min_rooms,
                                unsigned max_rooms, unsigned num_breaches, unsigned num_portals,
-                               size_t seed, bool load_prog_from_file, unsigned num_threads) : impl(
+                               size_t seed, bool load_prog_from_file, unsigned num_threads,
+                               ParallelMode parallel_mode, const char* portfolio_path, const char* config_path) : impl(
         std::make_unique<LevelGenImpl>(max_num_levels, width, height, min_rooms, max_rooms, num_breaches, num_portals,
-                                       seed, load_prog_from_file, num_threads))
+                                       seed, load_prog_from_file, num_threads, parallel_mode, portfolio_path,
+                                       config_path, ConfigMap{}))
+{}
+
+LevelGenerator::LevelGenerator(unsigned max_num_levels, unsigned width, unsigned height, unsigned min_rooms,
+                               unsigned max_rooms, unsigned num_breaches, unsigned num_portals,
+                               const ConfigMap& config_overrides, size_t seed, unsigned num_threads,
+                               ParallelMode parallel_mode) : impl(
+        std::make_unique<LevelGenImpl>(max_num_levels, width, height, min_rooms, max_rooms, num_breaches, num_portals,
+                                       seed, false, num_threads, parallel_mode, nullptr, nullptr, config_overrides))
 {}
 
 LevelGenerator& LevelGenerator::operator=(LevelGenerator&& other) noexcept = default;
@@ -282,11 +1013,73 @@ LevelGenerator::LevelGenerator(LevelGenerator&& other) noexcept = default;
 
 LevelGenerator::~LevelGenerator() = default;
 
+void LevelGenerator::set_inputs(unsigned min_rooms, unsigned max_rooms, unsigned num_breaches, unsigned num_portals,
+                                size_t seed)
+{
+    impl->set_inputs(min_rooms, max_rooms, num_breaches, num_portals, seed);
+}
+
+void LevelGenerator::set_opt_mode(OptMode mode, int max_cost)
+{
+    impl->set_opt_mode(mode, max_cost);
+}
+
+void LevelGenerator::set_max_kept_levels(size_t max_levels)
+{
+    impl->set_max_kept_levels(max_levels);
+}
+
+void LevelGenerator::set_level_callback(level_cb on_level)
+{
+    impl->set_level_callback(on_level);
+}
+
+void LevelGenerator::set_dump_models(bool dump)
+{
+    impl->set_dump_models(dump);
+}
+
 const char* LevelGenerator::solve(cancel_cb check_cancel)
 {
     return impl->solve(check_cancel);
 }
 
+const char* LevelGenerator::solve(const std::function<bool(void)>& check_cancel)
+{
+    return impl->solve(check_cancel);
+}
+
+const char* LevelGenerator::solve(CancelToken& token)
+{
+    return impl->solve(*token.impl);
+}
+
+const char* LevelGenerator::solve(CancelToken& token, const std::function<bool(void)>& check_cancel)
+{
+    return impl->solve(*token.impl, check_cancel);
+}
+
+TimedSolveResult LevelGenerator::solve_for(std::chrono::milliseconds budget)
+{
+    return impl->solve_for(budget);
+}
+
+TimedSolveResult LevelGenerator::solve_for(unsigned budget_ms)
+{
+    return impl->solve_for(std::chrono::milliseconds(budget_ms));
+}
+
+AsyncSolve* LevelGenerator::solve_async()
+{
+    impl->solve_async();
+    if (!impl->async_solve)
+    {
+        impl->async_solve = std::unique_ptr<AsyncSolve>(
+                new AsyncSolve(std::make_unique<AsyncSolve::AsyncSolveImpl>(*impl)));
+    }
+    return impl->async_solve.get();
+}
+
 const char* LevelGenerator::solve_safe(cancel_cb check_cancel)
 {
     try
@@ -304,11 +1097,26 @@ Level* LevelGenerator::best_level()
     return impl->best_level();
 }
 
+std::unique_ptr<Level> take_best_level(LevelGenerator& gen)
+{
+    return gen.impl->take_best();
+}
+
 size_t LevelGenerator::get_num_levels() const
 {
     return impl->num_levels();
 }
 
+const char* LevelGenerator::get_config_profile() const
+{
+    return impl->get_config_profile();
+}
+
+GenStats LevelGenerator::get_stats() const
+{
+    return impl->get_stats();
+}
+
 void LevelGenerator::interrupt()
 {
     impl->interrupt();
@@ -0,0 +1,270 @@
+#include "level_gen.h"
+
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+    constexpr int unreachable = -1;
+
+    /// The connections between rooms, in compressed sparse row form, with breach rooms removed. Rooms are indexed
+    /// from zero, in the same order as the level's rooms.
+    class RoomGraph
+    {
+        public:
+            explicit RoomGraph(const Level& level)
+            {
+                auto rooms = level.rooms();
+                node_by_room_id.assign(rooms.count() + 1, unreachable);
+                breached_by_room_id.assign(rooms.count() + 1, false);
+
+                rooms.reset();
+                while (rooms.move_next())
+                {
+                    const auto room = rooms.current();
+                    if (room.type == RoomType::AlienBreach)
+                    {
+                        continue;
+                    }
+                    node_by_room_id[room.room_id] = static_cast<int>(areas.size());
+                    areas.push_back(room.w * room.h);
+                }
+
+                // Doors and portals are both stored once in each direction, so are already symmetric. Doors to breach
+                // rooms mark the room they breach as dangerous instead.
+                std::vector<std::pair<int, int>> edges;
+                auto doors = level.doors();
+                doors.reset();
+                while (doors.move_next())
+                {
+                    const auto door = doors.current();
+                    add_edge(edges, door.first_id, door.second_id);
+                }
+                auto portals = level.portals();
+                portals.reset();
+                while (portals.move_next())
+                {
+                    const auto portal = portals.current();
+                    add_edge(edges, portal.first_id, portal.second_id);
+                }
+
+                offsets.assign(areas.size() + 1, 0);
+                for (const auto& edge : edges)
+                {
+                    ++offsets[edge.first + 1];
+                }
+                std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+
+                targets.resize(edges.size());
+                auto next = offsets;
+                for (const auto& edge : edges)
+                {
+                    targets[next[edge.first]++] = edge.second;
+                }
+
+                for (size_t room_id = 0; room_id < breached_by_room_id.size(); ++room_id)
+                {
+                    if (breached_by_room_id[room_id] && node_by_room_id[room_id] != unreachable)
+                    {
+                        danger.push_back(node_by_room_id[room_id]);
+                    }
+                }
+            }
+
+            size_t size() const
+            {
+                return areas.size();
+            }
+
+            size_t degree(int node) const
+            {
+                return offsets[node + 1] - offsets[node];
+            }
+
+            int node(size_t room_id) const
+            {
+                return room_id < node_by_room_id.size() ? node_by_room_id[room_id] : unreachable;
+            }
+
+            /// Breadth-first search from a set of rooms, giving each room's distance to the closest of them
+            std::vector<int> distances_from(const std::vector<int>& sources, std::vector<int>* parents = nullptr) const
+            {
+                std::vector<int> distances(size(), unreachable);
+                if (parents)
+                {
+                    parents->assign(size(), unreachable);
+                }
+
+                std::deque<int> queue;
+                for (const auto source : sources)
+                {
+                    if (distances[source] == unreachable)
+                    {
+                        distances[source] = 0;
+                        queue.push_back(source);
+                    }
+                }
+
+                while (!queue.empty())
+                {
+                    const auto current = queue.front();
+                    queue.pop_front();
+                    for (auto i = offsets[current]; i < offsets[current + 1]; ++i)
+                    {
+                        const auto next = targets[i];
+                        if (distances[next] == unreachable)
+                        {
+                            distances[next] = distances[current] + 1;
+                            if (parents)
+                            {
+                                (*parents)[next] = current;
+                            }
+                            queue.push_back(next);
+                        }
+                    }
+                }
+                return distances;
+            }
+
+            std::vector<unsigned> areas;
+            std::vector<int> danger;
+
+        private:
+            std::vector<int> node_by_room_id;  // Room IDs are one-based, so index zero is unused
+            std::vector<bool> breached_by_room_id;
+            std::vector<size_t> offsets;
+            std::vector<int> targets;
+
+            void add_edge(std::vector<std::pair<int, int>>& edges, size_t first_id, size_t second_id)
+            {
+                const auto first = node(first_id);
+                const auto second = node(second_id);
+                if (first != unreachable && second != unreachable)
+                {
+                    edges.emplace_back(first, second);
+                }
+                else if (first != unreachable && second_id < breached_by_room_id.size())
+                {
+                    breached_by_room_id[first_id] = true;
+                }
+            }
+    };
+
+    /// The rooms on the shortest path from start to finish, or just the start and finish if there is no path
+    std::vector<int> shortest_path(const RoomGraph& graph, int start, int finish)
+    {
+        std::vector<int> parents;
+        const auto distances = graph.distances_from({start}, &parents);
+        if (distances[finish] == unreachable)
+        {
+            return {start, finish};
+        }
+
+        std::vector<int> path;
+        for (auto node = finish; node != unreachable; node = parents[node])
+        {
+            path.push_back(node);
+        }
+        return path;
+    }
+
+    /// Average distance from a set of rooms over some other rooms, treating unreachable rooms as the furthest possible
+    double average_distance(const std::vector<int>& distances, const std::vector<int>& rooms, size_t num_rooms)
+    {
+        auto total = 0.0;
+        for (const auto room : rooms)
+        {
+            total += distances[room] == unreachable
+                     ? static_cast<double>(num_rooms)
+                     : std::min(static_cast<double>(distances[room]), static_cast<double>(num_rooms));
+        }
+        return total / static_cast<double>(rooms.size());
+    }
+}
+
+LevelMetrics::LevelMetrics(const Level& level, unsigned max_room_size)
+    : density(0.0), exploration(0.0), map_linearity(0.0), path_redundancy(0.0), proximity_to_danger(1.0),
+      average_room_size(0.0), room_count(0.0)
+{
+    const RoomGraph graph(level);
+    const auto num_rooms = graph.size();
+
+    // Ship area is every square inside the hull, i.e. ship squares, plus the rooms and corridors drawn over them
+    // The grid is dense, so covers every square, whereas get_num_map_squares() only counts those with a type
+    const auto* grid = level.grid_squares();
+    const auto num_grid_squares = static_cast<size_t>(level.get_width()) * level.get_height();
+    const auto ship_mask = static_cast<uint8_t>(
+            static_cast<uint8_t>(SquareType::Ship)
+            | static_cast<uint8_t>(SquareType::Room)
+            | static_cast<uint8_t>(SquareType::Corridor));
+    const auto ship_area = std::count_if(grid, grid + num_grid_squares, [&](uint8_t square)
+    {
+        return (square & ship_mask) != 0;
+    });
+
+    const auto room_area = std::accumulate(graph.areas.cbegin(), graph.areas.cend(), 0.0);
+    if (ship_area > 0)
+    {
+        density = room_area / static_cast<double>(ship_area);
+        room_count = static_cast<double>(num_rooms) / static_cast<double>(ship_area);
+    }
+    if (num_rooms == 0)
+    {
+        return;
+    }
+    average_room_size = room_area / static_cast<double>(num_rooms * std::max(max_room_size, 1U));
+
+    // Dead ends do not count towards linearity, and with no branching rooms at all, the map is a single line
+    auto linearity_total = 0.0;
+    auto num_branching = 0UL;
+    for (size_t node = 0; node < num_rooms; ++node)
+    {
+        const auto degree = graph.degree(static_cast<int>(node));
+        if (degree > 1)
+        {
+            linearity_total += 1.0 / static_cast<double>(degree - 1);
+            ++num_branching;
+        }
+    }
+    map_linearity = num_branching > 0 ? linearity_total / static_cast<double>(num_branching) : 1.0;
+
+    const auto start = graph.node(level.get_start_room());
+    const auto finish = graph.node(level.get_finish_room());
+    if (start == unreachable || finish == unreachable)
+    {
+        return;  // The path-based metrics are meaningless without a start and finish
+    }
+
+    const auto path = shortest_path(graph, start, finish);
+    path_redundancy = static_cast<double>(num_rooms - path.size()) / static_cast<double>(num_rooms);
+
+    // One search from the whole path finds each off-path room's distance to its closest path room
+    std::vector<bool> on_path(num_rooms, false);
+    for (const auto node : path)
+    {
+        on_path[node] = true;
+    }
+    std::vector<int> off_path;
+    for (size_t node = 0; node < num_rooms; ++node)
+    {
+        if (!on_path[node])
+        {
+            off_path.push_back(static_cast<int>(node));
+        }
+    }
+    if (!off_path.empty())
+    {
+        // Normalised by half the number of rooms, which is the max possible average
+        exploration = average_distance(graph.distances_from(path), off_path, num_rooms)
+                      / (static_cast<double>(num_rooms) / 2.0);
+    }
+
+    // Likewise, one search from all sources of danger, normalised by the number of rooms, the max possible distance
+    if (!graph.danger.empty())
+    {
+        proximity_to_danger = average_distance(graph.distances_from(graph.danger), path, num_rooms)
+                              / static_cast<double>(num_rooms);
+    }
+}
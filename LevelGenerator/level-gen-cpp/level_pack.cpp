@@ -0,0 +1,265 @@
+#include "level_gen.h"
+#include "byte_io.h"
+
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// Level pack format identifier and version - bump the version whenever the format changes
+    const char pack_magic[] = "WSPK";
+    constexpr uint16_t pack_format_version = 1;
+
+    /// Size of the pack header, before the index of levels
+    constexpr size_t pack_header_size = 4 + sizeof(uint16_t) * 2 + sizeof(uint32_t);
+
+    /// Size of each index entry, holding the offset and size of a level
+    constexpr size_t pack_index_entry_size = sizeof(uint64_t) * 2;
+
+    /// A read-only memory mapping of a whole file
+    class MappedFile
+    {
+        public:
+            explicit MappedFile(const char* path)
+            {
+#ifdef _WIN32
+                file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, nullptr);
+                LARGE_INTEGER file_size;
+                if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+                {
+                    close();
+                    throw std::runtime_error(std::string("failed to open level pack: ") + path);
+                }
+                size = static_cast<size_t>(file_size.QuadPart);
+
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                data = mapping ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+                const auto fd = open(path, O_RDONLY);
+                struct stat file_stat{};
+                if (fd < 0 || fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+                {
+                    if (fd >= 0)
+                    {
+                        ::close(fd);
+                    }
+                    throw std::runtime_error(std::string("failed to open level pack: ") + path);
+                }
+                size = static_cast<size_t>(file_stat.st_size);
+
+                // The mapping stays valid after the file is closed
+                auto* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+                data = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+#endif
+                if (!data)
+                {
+                    close();
+                    throw std::runtime_error(std::string("failed to map level pack: ") + path);
+                }
+            }
+
+            ~MappedFile()
+            {
+                close();
+            }
+
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile& operator=(const MappedFile& other) = delete;
+
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+
+        private:
+#ifdef _WIN32
+            HANDLE file = INVALID_HANDLE_VALUE;
+            HANDLE mapping = nullptr;
+#endif
+
+            void close()
+            {
+#ifdef _WIN32
+                if (data)
+                {
+                    UnmapViewOfFile(data);
+                }
+                if (mapping)
+                {
+                    CloseHandle(mapping);
+                }
+                if (file != INVALID_HANDLE_VALUE)
+                {
+                    CloseHandle(file);
+                }
+                mapping = nullptr;
+                file = INVALID_HANDLE_VALUE;
+#else
+                if (data)
+                {
+                    munmap(const_cast<uint8_t*>(data), size);
+                }
+#endif
+                data = nullptr;
+            }
+    };
+
+    struct PackEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+}
+
+class LevelPack::LevelPackImpl
+{
+    public:
+        explicit LevelPackImpl(const char* path) : file(std::make_unique<MappedFile>(path))
+        {
+            read_index(file->data, file->size);
+        }
+
+        LevelPackImpl(const uint8_t* data, size_t size)
+        {
+            read_index(data, size);
+        }
+
+    private:
+        std::unique_ptr<MappedFile> file;  // Only set if the pack was opened from a file
+        const uint8_t* data = nullptr;
+        std::vector<PackEntry> entries;
+        std::unique_ptr<Level> loaded;  // Keeps the last loaded level alive for the caller
+
+        void read_index(const uint8_t* pack_data, size_t pack_size)
+        {
+            ByteReader reader(pack_data, pack_size);
+            reader.expect_magic(pack_magic);
+            const auto version = reader.read<uint16_t>();
+            if (version != pack_format_version)
+            {
+                throw std::runtime_error("unsupported level pack version: " + std::to_string(version));
+            }
+            reader.read<uint16_t>();  // Reserved
+
+            // Check the count against the data before reserving, so a corrupt count cannot ask for gigabytes
+            const auto num_levels = reader.read<uint32_t>();
+            if (num_levels > reader.remaining() / pack_index_entry_size)
+            {
+                throw std::runtime_error("invalid level pack: index of " + std::to_string(num_levels)
+                                         + " levels is truncated");
+            }
+            entries.reserve(num_levels);
+            for (auto i = 0U; i < num_levels; ++i)
+            {
+                const auto offset = reader.read<uint64_t>();
+                const auto size = reader.read<uint64_t>();
+                if (offset > pack_size || size > pack_size - offset)
+                {
+                    throw std::runtime_error("invalid level pack: level " + std::to_string(i) + " is out of range");
+                }
+                entries.push_back({offset, size});
+            }
+            data = pack_data;
+        }
+
+        size_t num_levels() const
+        {
+            return entries.size();
+        }
+
+        std::unique_ptr<Level> read_level(size_t index) const
+        {
+            if (index >= entries.size())
+            {
+                throw std::out_of_range("level index out of range: " + std::to_string(index));
+            }
+            const auto& entry = entries[index];
+            return Level::deserialize(data + entry.offset, static_cast<size_t>(entry.size));
+        }
+
+        Level* load_level(size_t index)
+        {
+            loaded = read_level(index);
+            return loaded.get();
+        }
+
+        friend class LevelPack;
+};
+
+LevelPack::LevelPack(const char* path) : impl(std::make_unique<LevelPackImpl>(path))
+{}
+
+LevelPack::LevelPack(const uint8_t* data, size_t size) : impl(std::make_unique<LevelPackImpl>(data, size))
+{}
+
+LevelPack& LevelPack::operator=(LevelPack&& other) noexcept = default;
+
+LevelPack::LevelPack(LevelPack&& other) noexcept = default;
+
+LevelPack::~LevelPack() = default;
+
+size_t LevelPack::get_num_levels() const
+{
+    return impl->num_levels();
+}
+
+Level* LevelPack::load_level(size_t index)
+{
+    return impl->load_level(index);
+}
+
+std::unique_ptr<Level> LevelPack::read_level(size_t index) const
+{
+    return impl->read_level(index);
+}
+
+void LevelPack::write(const char* path, const std::vector<const Level*>& levels)
+{
+    std::vector<std::vector<uint8_t>> level_data;
+    level_data.reserve(levels.size());
+    for (const auto* level : levels)
+    {
+        level_data.push_back(level->serialize());
+    }
+
+    std::vector<uint8_t> out;
+    ByteWriter writer(out);
+    writer.write_bytes(reinterpret_cast<const uint8_t*>(pack_magic), std::strlen(pack_magic));
+    writer.write<uint16_t>(pack_format_version);
+    writer.write<uint16_t>(0);  // Reserved
+    writer.write<uint32_t>(static_cast<uint32_t>(level_data.size()));
+
+    // Levels follow the index directly, in order
+    auto offset = static_cast<uint64_t>(pack_header_size + pack_index_entry_size * level_data.size());
+    for (const auto& data : level_data)
+    {
+        writer.write<uint64_t>(offset);
+        writer.write<uint64_t>(data.size());
+        offset += data.size();
+    }
+    for (const auto& data : level_data)
+    {
+        writer.write_bytes(data.data(), data.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size())))
+    {
+        throw std::runtime_error(std::string("failed to write level pack: ") + path);
+    }
+}
@@ -0,0 +1,210 @@
+#include "level_gen.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class LevelPool::LevelPoolImpl
+{
+    public:
+        LevelPoolImpl(unsigned capacity, unsigned width, unsigned height, unsigned min_rooms, unsigned max_rooms,
+                      unsigned num_breaches, unsigned num_portals, unsigned num_workers, unsigned max_num_levels,
+                      unsigned num_threads) : capacity(std::max(capacity, 1U))
+        {
+            // Each worker reuses its own generator, so the program is only grounded once per worker
+            for (auto i = 0U; i < std::max(num_workers, 1U); ++i)
+            {
+                generators.emplace_back(std::make_unique<LevelGenerator>(
+                        max_num_levels, width, height, min_rooms, max_rooms, num_breaches, num_portals,
+                        0, false, num_threads));
+            }
+
+            active_workers = generators.size();
+            for (const auto& gen : generators)
+            {
+                auto* gen_ptr = gen.get();
+                workers.emplace_back([this, gen_ptr]() { fill(*gen_ptr); });
+            }
+        }
+
+        ~LevelPoolImpl()
+        {
+            stop();
+        }
+
+    private:
+        const size_t capacity;
+
+        std::vector<std::unique_ptr<LevelGenerator>> generators;
+        std::vector<std::thread> workers;
+
+        std::deque<std::unique_ptr<Level>> ready;
+        std::unique_ptr<Level> taken;  // Keeps the last taken level alive for the caller
+        size_t in_progress = 0;
+        size_t active_workers = 0;
+        bool stopping = false;
+        CancelToken stop_token;  // Shared by every worker, so stop() also catches those still grounding
+        std::exception_ptr worker_error;  // The first error from any worker, rethrown once no levels are ready
+
+        mutable std::mutex pool_mutex;
+        std::condition_variable space_available;
+        std::condition_variable level_ready;
+
+        /// Worker loop - solve for a new level whenever the pool has space
+        void fill(LevelGenerator& gen)
+        {
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(pool_mutex);
+                    space_available.wait(lock, [&]() { return stopping || ready.size() + in_progress < capacity; });
+                    if (stopping)
+                    {
+                        break;
+                    }
+                    ++in_progress;
+                }
+
+                std::unique_ptr<Level> level;
+                std::exception_ptr error;
+                try
+                {
+                    gen.solve(stop_token);
+                    level = take_best_level(gen);
+                }
+                catch (const std::exception&)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> guard(pool_mutex);
+                --in_progress;
+                if (error && !worker_error)
+                {
+                    worker_error = error;
+                }
+                if (!level)
+                {
+                    // Either interrupted, failed, or no level can ever be generated with these params, so stop this
+                    // worker
+                    break;
+                }
+                ready.push_back(std::move(level));
+                level_ready.notify_one();
+            }
+
+            std::lock_guard<std::mutex> guard(pool_mutex);
+            --active_workers;
+            level_ready.notify_all();  // Wake any waiters, in case no more levels will be generated
+        }
+
+        Level* pop_ready()
+        {
+            taken = std::move(ready.front());
+            ready.pop_front();
+            space_available.notify_one();
+            return taken.get();
+        }
+
+        /// Call with the pool mutex held, once no level is ready
+        void rethrow_worker_error() const
+        {
+            if (worker_error)
+            {
+                std::rethrow_exception(worker_error);
+            }
+        }
+
+        Level* try_take()
+        {
+            std::lock_guard<std::mutex> guard(pool_mutex);
+            if (ready.empty())
+            {
+                rethrow_worker_error();
+                return nullptr;
+            }
+            return pop_ready();
+        }
+
+        Level* take(unsigned timeout_ms)
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            level_ready.wait_for(
+                    lock,
+                    std::chrono::milliseconds(timeout_ms),
+                    [&]() { return !ready.empty() || active_workers == 0; });
+            if (ready.empty())
+            {
+                rethrow_worker_error();
+                return nullptr;
+            }
+            return pop_ready();
+        }
+
+        size_t num_ready() const
+        {
+            std::lock_guard<std::mutex> guard(pool_mutex);
+            return ready.size();
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> guard(pool_mutex);
+                stopping = true;
+            }
+            space_available.notify_all();
+
+            // A worker that is still grounding cannot be interrupted, but the token stops it before it searches
+            stop_token.cancel();
+            for (auto& worker : workers)
+            {
+                if (worker.joinable())
+                {
+                    worker.join();
+                }
+            }
+        }
+
+        friend class LevelPool;
+};
+
+LevelPool::LevelPool(unsigned capacity, unsigned width, unsigned height, unsigned min_rooms, unsigned max_rooms,
+                     unsigned num_breaches, unsigned num_portals, unsigned num_workers, unsigned max_num_levels,
+                     unsigned num_threads) : impl(
+        std::make_unique<LevelPoolImpl>(capacity, width, height, min_rooms, max_rooms, num_breaches, num_portals,
+                                        num_workers, max_num_levels, num_threads))
+{}
+
+LevelPool& LevelPool::operator=(LevelPool&& other) noexcept = default;
+
+LevelPool::LevelPool(LevelPool&& other) noexcept = default;
+
+LevelPool::~LevelPool() = default;
+
+Level* LevelPool::try_take()
+{
+    return impl->try_take();
+}
+
+Level* LevelPool::take(unsigned timeout_ms)
+{
+    return impl->take(timeout_ms);
+}
+
+size_t LevelPool::get_num_ready() const
+{
+    return impl->num_ready();
+}
+
+void LevelPool::stop()
+{
+    impl->stop();
+}
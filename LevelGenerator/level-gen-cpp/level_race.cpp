@@ -0,0 +1,194 @@
+#include "level_gen.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class RacingLevelGenerator::RacingImpl
+{
+    public:
+        RacingImpl(unsigned num_racers, unsigned max_num_levels, unsigned width, unsigned height, unsigned min_rooms,
+                   unsigned max_rooms, unsigned num_breaches, unsigned num_portals, size_t seed, unsigned num_threads)
+        {
+            // Each racer reuses its own generator, so the program is only grounded once per racer
+            for (auto i = 0U; i < std::max(num_racers, 1U); ++i)
+            {
+                generators.emplace_back(std::make_unique<LevelGenerator>(
+                        max_num_levels, width, height, min_rooms, max_rooms, num_breaches, num_portals,
+                        seed == 0 ? 0 : seed + i, false, num_threads));
+                tokens.emplace_back(std::make_unique<CancelToken>());
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<LevelGenerator>> generators;
+        std::vector<std::unique_ptr<CancelToken>> tokens;  // One per racer, to stop it once the race is over
+        std::unique_ptr<Level> result;  // Keeps the last returned level alive for the caller
+        int winner = -1;
+
+        // Race state, reset for each solve
+        size_t num_finished = 0;
+        bool race_won = false;
+        bool cancelled = false;
+        std::exception_ptr racer_error;  // The first error from any racer
+
+        std::mutex race_mutex;
+        std::condition_variable race_changed;
+
+        static bool meets_threshold(LevelGenerator& gen, int max_cost)
+        {
+            const auto* best = gen.best_level();
+            return best && best->get_cost() <= max_cost;
+        }
+
+        /// Racer loop - solve until this racer wins, or another racer has already won
+        void race(size_t index, int max_cost, cancel_cb check_cancel)
+        {
+            auto& gen = *generators[index];
+            try
+            {
+                gen.solve(*tokens[index], [&]()
+                {
+                    if (check_cancel && check_cancel())
+                    {
+                        std::lock_guard<std::mutex> guard(race_mutex);
+                        cancelled = true;
+                        race_changed.notify_all();
+                        return true;
+                    }
+
+                    const auto won = meets_threshold(gen, max_cost);
+                    std::lock_guard<std::mutex> guard(race_mutex);
+                    if (won && !race_won)
+                    {
+                        race_won = true;
+                        winner = static_cast<int>(index);
+                        race_changed.notify_all();
+                    }
+                    return race_won || cancelled;
+                });
+            }
+            catch (const std::exception&)
+            {
+                std::lock_guard<std::mutex> guard(race_mutex);
+                if (!racer_error)
+                {
+                    racer_error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(race_mutex);
+            ++num_finished;
+            race_changed.notify_all();
+        }
+
+        Level* solve(int max_cost, cancel_cb check_cancel)
+        {
+            result.reset();
+            winner = -1;
+            num_finished = 0;
+            race_won = false;
+            cancelled = false;
+            racer_error = nullptr;
+
+            std::vector<std::thread> racers;
+            for (size_t i = 0; i < generators.size(); ++i)
+            {
+                racers.emplace_back([this, i, max_cost, check_cancel]() { race(i, max_cost, check_cancel); });
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(race_mutex);
+                race_changed.wait(lock, [&]() { return race_won || cancelled || num_finished == generators.size(); });
+            }
+
+            // Cancelling a token only interrupts a racer while it is searching, and stops one that has not started
+            // searching yet, so the racers that already finished are never left with an interrupt for the next solve
+            interrupt();
+
+            for (auto& racer : racers)
+            {
+                racer.join();
+            }
+
+            // Only reset once every racer has stopped, so an interrupt made just before this solve still stopped it
+            for (auto& token : tokens)
+            {
+                token->reset();
+            }
+            if (racer_error && !race_won)
+            {
+                // A fallback level could hide a racer that can never work, e.g. with a bad config
+                std::rethrow_exception(racer_error);
+            }
+
+            if (winner < 0)
+            {
+                // No racer met the threshold, so fall back to the best level from any of them
+                for (size_t i = 0; i < generators.size(); ++i)
+                {
+                    const auto* best = generators[i]->best_level();
+                    const auto* current_best = winner < 0 ? nullptr : generators[winner]->best_level();
+                    if (best && (!current_best || best->get_cost() < current_best->get_cost()))
+                    {
+                        winner = static_cast<int>(i);
+                    }
+                }
+            }
+
+            if (winner >= 0)
+            {
+                result = take_best_level(*generators[winner]);
+            }
+            return result.get();
+        }
+
+        void interrupt()
+        {
+            for (auto& token : tokens)
+            {
+                token->cancel();
+            }
+        }
+
+        friend class RacingLevelGenerator;
+};
+
+RacingLevelGenerator::RacingLevelGenerator(unsigned num_racers, unsigned max_num_levels, unsigned width,
+                                           unsigned height, unsigned min_rooms, unsigned max_rooms,
+                                           unsigned num_breaches, unsigned num_portals, size_t seed,
+                                           unsigned num_threads) : impl(
+        std::make_unique<RacingImpl>(num_racers, max_num_levels, width, height, min_rooms, max_rooms, num_breaches,
+                                     num_portals, seed, num_threads))
+{}
+
+RacingLevelGenerator& RacingLevelGenerator::operator=(RacingLevelGenerator&& other) noexcept = default;
+
+RacingLevelGenerator::RacingLevelGenerator(RacingLevelGenerator&& other) noexcept = default;
+
+RacingLevelGenerator::~RacingLevelGenerator() = default;
+
+Level* RacingLevelGenerator::solve(int max_cost, cancel_cb check_cancel)
+{
+    return impl->solve(max_cost, check_cancel);
+}
+
+void RacingLevelGenerator::interrupt()
+{
+    impl->interrupt();
+}
+
+int RacingLevelGenerator::get_winner() const
+{
+    return impl->winner;
+}
+
+unsigned RacingLevelGenerator::get_num_racers() const
+{
+    return static_cast<unsigned>(impl->generators.size());
+}
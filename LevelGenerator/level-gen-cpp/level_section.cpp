@@ -0,0 +1,530 @@
+#include "level_gen.h"
+#include "program.h"
+#include "ship_geometry.h"
+#include "clingo.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /// A rectangle of the grid, from (min_x, min_y) to (max_x, max_y) inclusive, solved as its own sub-problem
+    struct Section
+    {
+        int min_x;
+        int min_y;
+        int max_x;
+        int max_y;
+
+        unsigned ship_area = 0;
+        unsigned room_area = 0;  // The number of places a 2x2 room would fit
+        unsigned min_rooms = 0;
+        unsigned max_rooms = 0;
+        std::vector<std::pair<int, int>> links;  // Squares that must be corridors, to join neighbouring sections
+
+        std::string facts;  // The section's squares and links, for section.lp
+        std::string rooms;  // The rooms chosen for the section, for stitch.lp, or empty if it has not been solved
+
+        Section(int min_x, int min_y, int max_x, int max_y)
+            : min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y) {}
+    };
+
+    /// Split a length into parts of roughly part_size, returning the first index of each part, then one past the end
+    std::vector<int> split(unsigned length, unsigned part_size)
+    {
+        const auto num_parts = std::max(1U, (length + part_size / 2) / std::max(part_size, 1U));
+        std::vector<int> starts;
+        for (auto i = 0U; i <= num_parts; ++i)
+        {
+            starts.push_back(1 + static_cast<int>(i * length / num_parts));
+        }
+        return starts;
+    }
+
+    /// Share a total between sections in proportion to their areas, so the shares add up to exactly the total, unless
+    /// there is no area to share it between
+    std::vector<unsigned> share(unsigned total, const std::vector<unsigned>& areas)
+    {
+        const auto total_area = std::accumulate(areas.cbegin(), areas.cend(), (uint64_t) 0);
+        std::vector<unsigned> shares(areas.size(), 0U);
+        if (total_area == 0)
+        {
+            return shares;
+        }
+
+        std::vector<std::pair<uint64_t, size_t>> remainders;
+        auto num_shared = 0U;
+        for (size_t i = 0; i < areas.size(); ++i)
+        {
+            const auto exact = static_cast<uint64_t>(total) * areas[i];
+            shares[i] = static_cast<unsigned>(exact / total_area);
+            num_shared += shares[i];
+            remainders.emplace_back(exact % total_area, i);
+        }
+
+        // Whatever is left over after rounding down goes to the sections that lost the most by it
+        std::stable_sort(remainders.begin(), remainders.end(), [](const auto& left, const auto& right)
+        {
+            return left.first > right.first;
+        });
+        for (size_t i = 0; num_shared < total; ++i, ++num_shared)
+        {
+            ++shares[remainders[i].second];
+        }
+        return shares;
+    }
+
+    std::string to_facts(const Clingo::SymbolVector& symbols)
+    {
+        std::ostringstream out;
+        for (const auto& symbol : symbols)
+        {
+            out << symbol << ".";
+        }
+        return out.str();
+    }
+}
+
+class SectionedLevelGenerator::SectionedImpl
+{
+    public:
+        SectionedImpl(unsigned max_num_levels, unsigned width, unsigned height, unsigned min_rooms,
+                      unsigned max_rooms, unsigned num_breaches, unsigned num_portals, size_t seed,
+                      unsigned section_size, unsigned num_workers)
+            : max_num_levels(max_num_levels), width(width), height(height), min_rooms(min_rooms),
+              max_rooms(max_rooms), num_breaches(num_breaches), num_portals(num_portals), seed(seed),
+              num_workers(num_workers == 0 ? std::max(std::thread::hardware_concurrency(), 1U) : num_workers),
+              geometry(width, height)
+        {
+            lay_out_sections(section_size);
+        }
+
+    private:
+        const unsigned max_num_levels;
+        const unsigned width;
+        const unsigned height;
+        const unsigned min_rooms;
+        const unsigned max_rooms;
+        const unsigned num_breaches;
+        const unsigned num_portals;
+        const size_t seed;
+        const unsigned num_workers;
+
+        const ShipGeometry geometry;
+        std::vector<Section> sections;  // Only those with part of the ship in them
+        std::unique_ptr<Level> result;  // Keeps the last returned level alive for the caller
+
+        // Search state, reset for each solve
+        std::vector<Clingo::Control*> searching;
+        bool cancelled = false;
+        std::mutex search_mutex;
+
+        bool is_ship(int x, int y) const
+        {
+            return geometry.is(x, y, ShipGeometry::Square::Ship);
+        }
+
+        /// Split the grid into sections, then join each pair of neighbouring sections with a link either side of
+        /// their boundary, as near its middle as the ship allows
+        void lay_out_sections(unsigned section_size)
+        {
+            const auto xs = split(width, section_size);
+            const auto ys = split(height, section_size);
+            const auto num_columns = xs.size() - 1;
+            const auto num_rows = ys.size() - 1;
+
+            std::vector<Section> grid;
+            for (size_t row = 0; row < num_rows; ++row)
+            {
+                for (size_t column = 0; column < num_columns; ++column)
+                {
+                    grid.emplace_back(xs[column], ys[row], xs[column + 1] - 1, ys[row + 1] - 1);
+                }
+            }
+
+            for (size_t row = 0; row < num_rows; ++row)
+            {
+                for (size_t column = 0; column < num_columns; ++column)
+                {
+                    auto& section = grid[row * num_columns + column];
+                    if (column + 1 < num_columns)
+                    {
+                        auto& right = grid[row * num_columns + column + 1];
+                        const auto y = find_link(section.min_y, section.max_y, [&](int y)
+                        {
+                            return is_ship(section.max_x, y) && is_ship(right.min_x, y);
+                        });
+                        if (y > 0)
+                        {
+                            section.links.emplace_back(section.max_x, y);
+                            right.links.emplace_back(right.min_x, y);
+                        }
+                    }
+                    if (row + 1 < num_rows)
+                    {
+                        auto& below = grid[(row + 1) * num_columns + column];
+                        const auto x = find_link(section.min_x, section.max_x, [&](int x)
+                        {
+                            return is_ship(x, section.max_y) && is_ship(x, below.min_y);
+                        });
+                        if (x > 0)
+                        {
+                            section.links.emplace_back(x, section.max_y);
+                            below.links.emplace_back(x, below.min_y);
+                        }
+                    }
+                }
+            }
+
+            for (size_t row = 0; row < num_rows; ++row)
+            {
+                for (size_t column = 0; column < num_columns; ++column)
+                {
+                    auto& section = grid[row * num_columns + column];
+                    write_section_facts(section, column > 0, column + 1 < num_columns, row > 0, row + 1 < num_rows);
+                    if (section.ship_area > 0)
+                    {
+                        sections.push_back(std::move(section));
+                    }
+                }
+            }
+
+            // Rooms are shared out by the room each section has, so slivers of the ship, e.g. around the nose, which
+            // only fit corridors, are not asked for any
+            std::vector<unsigned> areas;
+            for (const auto& section : sections)
+            {
+                areas.push_back(section.room_area);
+            }
+
+            // Each section gets at least its share of min_rooms, and its share of the rooms above that, so the totals
+            // are within the bounds for the whole ship
+            const auto min_shares = share(min_rooms, areas);
+            const auto extra_shares = share(std::max(max_rooms, min_rooms) - min_rooms, areas);
+            for (size_t i = 0; i < sections.size(); ++i)
+            {
+                sections[i].min_rooms = min_shares[i];
+                sections[i].max_rooms = min_shares[i] + extra_shares[i];
+            }
+        }
+
+        /// The position nearest the middle of a boundary, excluding its ends, where both sides can be linked, or 0
+        template <typename F>
+        static int find_link(int min, int max, F&& can_link)
+        {
+            const auto middle = (min + max) / 2;
+            for (auto offset = 0; offset <= max - min; ++offset)
+            {
+                for (const auto position : {middle - offset, middle + offset + 1})
+                {
+                    if (position > min && position < max && can_link(position))
+                    {
+                        return position;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        void write_section_facts(Section& section, bool left, bool right, bool top, bool bottom)
+        {
+            std::ostringstream out;
+            out << geometry.section_facts(section.min_x, section.min_y, section.max_x, section.max_y);
+
+            for (auto y = section.min_y; y <= section.max_y; ++y)
+            {
+                for (auto x = section.min_x; x <= section.max_x; ++x)
+                {
+                    if (!is_ship(x, y))
+                    {
+                        continue;
+                    }
+                    ++section.ship_area;
+                    if (x < section.max_x && y < section.max_y
+                        && is_ship(x + 1, y) && is_ship(x, y + 1) && is_ship(x + 1, y + 1))
+                    {
+                        ++section.room_area;
+                    }
+
+                    const auto on_left = left && x == section.min_x;
+                    const auto on_right = right && x == section.max_x;
+                    const auto on_top = top && y == section.min_y;
+                    const auto on_bottom = bottom && y == section.max_y;
+                    if (on_left || on_right || on_top || on_bottom)
+                    {
+                        out << "edge(" << x << "," << y << ").";
+                    }
+                    if ((on_left || on_right) && (on_top || on_bottom))
+                    {
+                        out << "corner(" << x << "," << y << ").";
+                    }
+                }
+            }
+
+            for (const auto& link : section.links)
+            {
+                out << "link(" << link.first << "," << link.second << ").";
+            }
+            if (!section.links.empty())
+            {
+                out << "root(" << section.links.front().first << "," << section.links.front().second << ").";
+            }
+            out << "ship_area(" << section.ship_area << ").";
+            section.facts = out.str();
+        }
+
+        /// Search until the solver finishes, or the solve is cancelled, passing each model to on_model. Returns
+        /// false if it was cancelled.
+        template <typename F>
+        bool search(Clingo::Control& control, cancel_cb check_cancel, F&& on_model)
+        {
+            {
+                std::lock_guard<std::mutex> guard(search_mutex);
+                if (cancelled)
+                {
+                    return false;
+                }
+                searching.push_back(&control);
+            }
+
+            std::exception_ptr error;
+            try
+            {
+                for (const auto& m : control.solve())
+                {
+                    on_model(m);
+                    if (check_cancel && check_cancel())
+                    {
+                        interrupt();
+                        break;
+                    }
+                }
+            }
+            catch (const std::exception&)
+            {
+                error = std::current_exception();  // Rethrown once the control is no longer searching
+            }
+
+            std::lock_guard<std::mutex> guard(search_mutex);
+            searching.erase(std::find(searching.begin(), searching.end(), &control));
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+            return !cancelled;
+        }
+
+        void configure(Clingo::Control& control, size_t solve_seed) const
+        {
+            auto config = control.configuration();
+            config["solve.models"] = std::to_string(max_num_levels).c_str();
+            config["solver.seed"] = std::to_string(solve_seed).c_str();
+        }
+
+        /// Solve a section on its own, keeping the rooms from its best model
+        void solve_section(Section& section, size_t section_seed, cancel_cb check_cancel)
+        {
+            Clingo::Control control;
+            configure(control, section_seed);
+
+            std::ostringstream inputs;
+            inputs
+                    << "#const min_rooms = " << section.min_rooms << "." << std::endl
+                    << "#const max_rooms = " << section.max_rooms << "." << std::endl;
+            control.add("base", {}, section_prog);
+            control.add("base", {}, inputs.str().c_str());
+            control.add("base", {}, section.facts.c_str());
+            control.ground({{"base", {}}});
+
+            // Each model improves on the last, so the latest one is always the best so far
+            std::string rooms;
+            if (search(control, check_cancel, [&](const Clingo::Model& m) { rooms = to_facts(m.symbols()); }))
+            {
+                section.rooms = std::move(rooms);
+            }
+        }
+
+        /// Join the solved sections together, choosing the connections, portals, breaches and start and finish rooms
+        /// for the whole ship
+        void stitch(size_t stitch_seed, cancel_cb check_cancel)
+        {
+            Clingo::Control control;
+            configure(control, stitch_seed);
+
+            std::ostringstream inputs;
+            inputs
+                    << "num_breaches(" << num_breaches << ")." << std::endl
+                    << "num_portals(" << num_portals << ")." << std::endl;
+            control.add("base", {}, stitch_prog);
+            control.add("base", {}, connections_prog);
+            control.add("base", {}, inputs.str().c_str());
+            control.add("base", {}, geometry.facts().c_str());
+            for (const auto& section : sections)
+            {
+                control.add("base", {}, section.rooms.c_str());
+            }
+            control.ground({{"base", {}}});
+
+            std::unique_ptr<Level> best;
+            search(control, check_cancel, [&](const Clingo::Model& m)
+            {
+                const auto costs = m.cost();
+                const auto total_cost = std::accumulate(costs.cbegin(), costs.cend(), (int64_t) 0);
+
+                const auto model_symbols = m.symbols();
+                std::vector<clingo_symbol_t> transformed_symbols(model_symbols.size(), (clingo_symbol_t) 0);
+                std::transform(model_symbols.cbegin(), model_symbols.cend(), transformed_symbols.begin(),
+                               [](const auto& sym) { return sym.to_c(); });
+                best = std::make_unique<Level>(width, height, total_cost, std::move(transformed_symbols));
+            });
+            result = std::move(best);
+        }
+
+        Level* solve(cancel_cb check_cancel)
+        {
+            // The cancelled flag is only cleared once the solve is over, so an interrupt just before it still stops it
+            std::exception_ptr error;
+            try
+            {
+                solve_sections(check_cancel);
+            }
+            catch (const std::exception&)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(search_mutex);
+                cancelled = false;
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+            return result.get();
+        }
+
+        /// Solve every section, then stitch them together into the result, rethrowing the first error from any of them
+        void solve_sections(cancel_cb check_cancel)
+        {
+            result.reset();
+            for (auto& section : sections)
+            {
+                section.rooms.clear();
+            }
+
+            // As in ship.lp, the height must be even, so there is a central nose point
+            const auto has_room = std::any_of(sections.cbegin(), sections.cend(), [](const auto& section)
+            {
+                return section.room_area > 0;
+            });
+            if (sections.empty() || height % 2 == 1 || max_rooms < min_rooms || (min_rooms > 0 && !has_room))
+            {
+                return;
+            }
+
+            // A zero seed means "unset", so pick new random ones for every solve
+            const size_t solve_seed = seed == 0 ? std::random_device()() : seed;
+
+            // Workers take the next unsolved section until there are none left. They are independent, so any section
+            // failing means the whole level fails, and the rest are interrupted.
+            std::atomic<size_t> next_section{0};
+            std::exception_ptr worker_error;
+            std::vector<std::thread> workers;
+            for (auto i = 0U; i < std::min<size_t>(num_workers, sections.size()); ++i)
+            {
+                workers.emplace_back([&]()
+                {
+                    for (auto index = next_section++; index < sections.size(); index = next_section++)
+                    {
+                        auto& section = sections[index];
+                        try
+                        {
+                            solve_section(section, solve_seed + index, check_cancel);
+                        }
+                        catch (const std::exception&)
+                        {
+                            std::lock_guard<std::mutex> guard(search_mutex);
+                            if (!worker_error)
+                            {
+                                worker_error = std::current_exception();
+                            }
+                        }
+                        if (section.rooms.empty())
+                        {
+                            interrupt();
+                        }
+                    }
+                });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            if (worker_error)
+            {
+                std::rethrow_exception(worker_error);
+            }
+
+            const auto all_solved = std::all_of(sections.cbegin(), sections.cend(), [](const auto& section)
+            {
+                return !section.rooms.empty();
+            });
+            if (all_solved)
+            {
+                stitch(solve_seed + sections.size(), check_cancel);
+            }
+        }
+
+        void interrupt()
+        {
+            std::lock_guard<std::mutex> guard(search_mutex);
+            cancelled = true;
+            for (auto* control : searching)
+            {
+                control->interrupt();
+            }
+        }
+
+        friend class SectionedLevelGenerator;
+};
+
+SectionedLevelGenerator::SectionedLevelGenerator(unsigned max_num_levels, unsigned width, unsigned height,
+                                                 unsigned min_rooms, unsigned max_rooms, unsigned num_breaches,
+                                                 unsigned num_portals, size_t seed, unsigned section_size,
+                                                 unsigned num_workers) : impl(
+        std::make_unique<SectionedImpl>(max_num_levels, width, height, min_rooms, max_rooms, num_breaches,
+                                        num_portals, seed, section_size, num_workers))
+{}
+
+SectionedLevelGenerator& SectionedLevelGenerator::operator=(SectionedLevelGenerator&& other) noexcept = default;
+
+SectionedLevelGenerator::SectionedLevelGenerator(SectionedLevelGenerator&& other) noexcept = default;
+
+SectionedLevelGenerator::~SectionedLevelGenerator() = default;
+
+Level* SectionedLevelGenerator::solve(cancel_cb check_cancel)
+{
+    return impl->solve(check_cancel);
+}
+
+void SectionedLevelGenerator::interrupt()
+{
+    impl->interrupt();
+}
+
+unsigned SectionedLevelGenerator::get_num_sections() const
+{
+    return static_cast<unsigned>(impl->sections.size());
+}
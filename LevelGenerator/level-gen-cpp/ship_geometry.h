@@ -0,0 +1,188 @@
+#ifndef LEVELGENERATOR_SHIP_GEOMETRY_H
+#define LEVELGENERATOR_SHIP_GEOMETRY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// The static geometry of a ship, which only depends on the grid size. This matches programs/geometry.lp, and is
+/// added to the program as facts, so the solver does not have to ground the rules deriving it.
+class ShipGeometry
+{
+    public:
+        enum class Square : uint8_t
+        {
+            Space,
+            Hull,
+            Ship
+        };
+
+        ShipGeometry(unsigned width, unsigned height)
+            : width(width), height(height), squares(static_cast<size_t>(width) * height, Square::Ship)
+        {
+            const auto half_height = static_cast<int>(height / 2);
+            for (auto y = 1; y <= static_cast<int>(height); ++y)
+            {
+                for (auto x = 1; x <= static_cast<int>(width); ++x)
+                {
+                    // The two triangular regions around the nose of the ship, and the edges of the map
+                    const auto around_nose = x <= half_height && (y < half_height - x + 2 || y > half_height + x - 1);
+                    if (around_nose || x == 1 || y == 1 || x == static_cast<int>(width) || y == static_cast<int>(height))
+                    {
+                        set(x, y, Square::Space);
+                    }
+                }
+            }
+
+            // The hull is every square bordering space, that is not space itself
+            for (auto y = 1; y <= static_cast<int>(height); ++y)
+            {
+                for (auto x = 1; x <= static_cast<int>(width); ++x)
+                {
+                    if (!is(x, y, Square::Space) && (is(x, y - 1, Square::Space) || is(x, y + 1, Square::Space)
+                                                     || is(x - 1, y, Square::Space) || is(x + 1, y, Square::Space)))
+                    {
+                        set(x, y, Square::Hull);
+                    }
+                }
+            }
+        }
+
+        /// Whether a square has the given type, which is never true outside the grid
+        bool is(int x, int y, Square type) const
+        {
+            if (x < 1 || y < 1 || x > static_cast<int>(width) || y > static_cast<int>(height))
+            {
+                return false;
+            }
+            return squares[(y - 1) * static_cast<size_t>(width) + (x - 1)] == type;
+        }
+
+        /// Write the geometry as ASP facts: grid/2, in_space/2, hull/2, ship/2, room_anchor/4 and breach_site/6
+        std::string facts() const
+        {
+            std::ostringstream out;
+            for (auto y = 1; y <= static_cast<int>(height); ++y)
+            {
+                for (auto x = 1; x <= static_cast<int>(width); ++x)
+                {
+                    out << "grid(" << x << "," << y << ").";
+                    if (is(x, y, Square::Space))
+                    {
+                        out << "in_space(" << x << "," << y << ").";
+                    }
+                    else if (is(x, y, Square::Hull))
+                    {
+                        out << "hull(" << x << "," << y << ").";
+                    }
+                    else
+                    {
+                        out << "ship(" << x << "," << y << ").";
+                    }
+                    add_room_anchors(out, x, y, static_cast<int>(width), static_cast<int>(height));
+                    add_breach_sites(out, x, y);
+                }
+                out << '\n';
+            }
+            return out.str();
+        }
+
+        /// Write the facts for one section of the grid, from (min_x, min_y) to (max_x, max_y) inclusive: ship/2 for
+        /// the ship squares in it, and room_anchor/4 for the rooms that fit entirely within it
+        std::string section_facts(int min_x, int min_y, int max_x, int max_y) const
+        {
+            std::ostringstream out;
+            for (auto y = min_y; y <= max_y; ++y)
+            {
+                for (auto x = min_x; x <= max_x; ++x)
+                {
+                    if (is_ship(x, y))
+                    {
+                        out << "ship(" << x << "," << y << ").";
+                        add_room_anchors(out, x, y, max_x, max_y);
+                    }
+                }
+                out << '\n';
+            }
+            return out.str();
+        }
+
+    private:
+        const unsigned width;
+        const unsigned height;
+        std::vector<Square> squares;
+
+        void set(int x, int y, Square type)
+        {
+            squares[(y - 1) * static_cast<size_t>(width) + (x - 1)] = type;
+        }
+
+        bool is_ship(int x, int y) const
+        {
+            return is(x, y, Square::Ship);
+        }
+
+        /// Rooms from 2x2 to 4x4 with (x, y) as their top-left corner, all four corners in the ship, and their
+        /// bottom-right corner at most (max_x, max_y)
+        void add_room_anchors(std::ostream& out, int x, int y, int max_x, int max_y) const
+        {
+            if (!is_ship(x, y))
+            {
+                return;
+            }
+
+            for (auto w = 2; w <= std::min(4, max_x - x + 1); ++w)
+            {
+                for (auto h = 2; h <= std::min(4, max_y - y + 1); ++h)
+                {
+                    if (is_ship(x, y + h - 1) && is_ship(x + w - 1, y) && is_ship(x + w - 1, y + h - 1))
+                    {
+                        out << "room_anchor(" << x << "," << y << "," << w << "," << h << ").";
+                    }
+                }
+            }
+        }
+
+        /// Breaches that start in space at (x, y), penetrate a straight hull edge, and enter the ship beyond it
+        void add_breach_sites(std::ostream& out, int x, int y) const
+        {
+            if (!is(x, y, Square::Space))
+            {
+                return;
+            }
+
+            // The square entered must have ship squares two either side of it, across the direction of the breach
+            const auto straight_across = [&](int sx, int sy, int dx, int dy) {
+                return is_ship(sx + 2 * dx, sy + 2 * dy) && is_ship(sx + dx, sy + dy)
+                       && is_ship(sx - dx, sy - dy) && is_ship(sx - 2 * dx, sy - 2 * dy);
+            };
+
+            // Breaches are recorded by their top-left square, so those entering upwards or leftwards start at the hull
+            if (is(x, y + 1, Square::Hull) && straight_across(x, y + 2, 1, 0))
+            {
+                write_breach_site(out, x, y, 1, 2, x, y + 2);
+            }
+            if (is(x, y - 1, Square::Hull) && straight_across(x, y - 2, 1, 0))
+            {
+                write_breach_site(out, x, y - 1, 1, 2, x, y - 2);
+            }
+            if (is(x + 1, y, Square::Hull) && straight_across(x + 2, y, 0, 1))
+            {
+                write_breach_site(out, x, y, 2, 1, x + 2, y);
+            }
+            if (is(x - 1, y, Square::Hull) && straight_across(x - 2, y, 0, 1))
+            {
+                write_breach_site(out, x - 1, y, 2, 1, x - 2, y);
+            }
+        }
+
+        static void write_breach_site(std::ostream& out, int x, int y, int w, int h, int entered_x, int entered_y)
+        {
+            out << "breach_site(" << x << "," << y << "," << w << "," << h << "," << entered_x << "," << entered_y
+                << ").";
+        }
+};
+
+#endif //LEVELGENERATOR_SHIP_GEOMETRY_H
@@ -0,0 +1,81 @@
+#ifndef LEVELGENERATOR_SOLVER_CONFIG_H
+#define LEVELGENERATOR_SOLVER_CONFIG_H
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// A clingo solver configuration, as (key, value) pairs applied in order, e.g. ("solver.heuristic", "Vsids,94")
+using SolverConfig = std::vector<std::pair<std::string, std::string>>;
+
+namespace solver_config_detail
+{
+    inline std::string trim(const std::string& str)
+    {
+        const auto* whitespace = " \t\r\n";
+        const auto start = str.find_first_not_of(whitespace);
+        if (start == std::string::npos)
+        {
+            return {};
+        }
+        return str.substr(start, str.find_last_not_of(whitespace) - start + 1);
+    }
+}
+
+/// Read a configuration with one "key = value" per line, ignoring blank lines and comments starting with '#'.
+/// Throws if a line is not a valid setting.
+inline SolverConfig parse_solver_config(std::istream& in)
+{
+    SolverConfig config;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = solver_config_detail::trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        const auto separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            throw std::runtime_error("invalid solver config line: " + line);
+        }
+        auto key = solver_config_detail::trim(line.substr(0, separator));
+        auto value = solver_config_detail::trim(line.substr(separator + 1));
+        if (key.empty() || value.empty())
+        {
+            throw std::runtime_error("invalid solver config line: " + line);
+        }
+        config.emplace_back(std::move(key), std::move(value));
+    }
+    return config;
+}
+
+inline SolverConfig parse_solver_config(const char* text)
+{
+    std::istringstream in(text);
+    return parse_solver_config(in);
+}
+
+inline void write_solver_config(std::ostream& out, const SolverConfig& config)
+{
+    for (const auto& entry : config)
+    {
+        out << entry.first << " = " << entry.second << std::endl;
+    }
+}
+
+/// Whether a key configures individual solvers, rather than the problem as a whole. These are replaced by each
+/// portfolio entry in compete mode, so must not be set there.
+inline bool is_per_solver_key(const std::string& key)
+{
+    return key == "configuration" || key.compare(0, std::strlen("solver."), "solver.") == 0;
+}
+
+#endif // LEVELGENERATOR_SOLVER_CONFIG_H
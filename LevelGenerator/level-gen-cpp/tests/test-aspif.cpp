@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+#include "aspif.h"
+#include "program.h"
+#include "ship_geometry.h"
+#include "clingo.hh"
+
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    /// Add and ground the embedded program for a 10x10 grid, as the generator does
+    void ground(Clingo::Control& solver)
+    {
+        std::ostringstream program;
+        program << ship_prog << std::endl << connections_prog << std::endl
+                << "#const width = 10." << std::endl
+                << "#const height = 10." << std::endl;
+        solver.add("base", {}, program.str().c_str());
+        solver.add("base", {}, ShipGeometry(10, 10).facts().c_str());
+        solver.ground({{"base", {}}});
+    }
+
+    /// Assign the inputs, then solve to the optimum, returning its cost, or the maximum if there is no level
+    int64_t optimal_cost(Clingo::Control& solver)
+    {
+        for (const auto* input : {"min_rooms(1)", "max_rooms(6)", "num_breaches(1)", "num_portals(1)"})
+        {
+            const auto atoms = solver.symbolic_atoms();
+            const auto found = atoms.find(Clingo::parse_term(input));
+            REQUIRE(found != atoms.end());
+            solver.assign_external(found->literal(), Clingo::TruthValue::True);
+        }
+
+        auto cost = std::numeric_limits<int64_t>::max();
+        for (const auto& m : solver.solve())
+        {
+            const auto costs = m.cost();
+            cost = std::accumulate(costs.cbegin(), costs.cend(), (int64_t) 0);
+        }
+        return cost;
+    }
+}
+
+SCENARIO("ground programs can be written as aspif and read back", "[levelgen][preground]")
+{
+    GIVEN("The embedded program, grounded while recording it as aspif")
+    {
+        AspifWriter writer;
+        Clingo::Control grounded;
+        grounded.register_observer(writer);
+        ground(grounded);
+
+        // As level-gen-preground does, so the inputs keep their names
+        const auto atoms = grounded.symbolic_atoms();
+        for (const auto* input : {"min_rooms", "max_rooms", "num_breaches", "num_portals"})
+        {
+            for (auto it = atoms.begin(Clingo::Signature(input, 1)); it != atoms.end(); ++it)
+            {
+                writer.name_atom(it->symbol(), it->literal());
+            }
+        }
+        const auto aspif = writer.finish();
+        REQUIRE(aspif.compare(0, 6, "asp 1 ") == 0);
+
+        WHEN("the aspif is read into a fresh solver")
+        {
+            Clingo::Control replayed;
+            REQUIRE_NOTHROW(AspifReader(replayed, aspif.c_str()).read());
+
+            THEN("the inputs can still be found by name")
+            {
+                const auto replayed_atoms = replayed.symbolic_atoms();
+                REQUIRE(replayed_atoms.find(Clingo::parse_term("min_rooms(1)")) != replayed_atoms.end());
+                REQUIRE(replayed_atoms.find(Clingo::parse_term("num_portals(1)")) != replayed_atoms.end());
+            }
+
+            THEN("it has the same optimum as the grounded program")
+            {
+                const auto expected = optimal_cost(grounded);
+                REQUIRE(expected != std::numeric_limits<int64_t>::max());
+                REQUIRE(optimal_cost(replayed) == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include "level_gen.h"
+
+SCENARIO("levels can be generated in batches", "[levelgen][batch]")
+{
+    GIVEN("A batch of params with mixed grid sizes")
+    {
+        std::vector<GenParams> params;
+        for (auto i = 0U; i < 6U; ++i)
+        {
+            const auto size = i % 2 == 0 ? 10U : 12U;
+            params.emplace_back(size, size, 1, 6, 1, 1, 1234 + i);
+        }
+
+        WHEN("generate_batch() is called with more than one worker")
+        {
+            std::vector<std::unique_ptr<Level>> levels;
+            REQUIRE_NOTHROW(levels = generate_batch(params, 3));
+
+            THEN("a level is returned for each set of params, in order")
+            {
+                REQUIRE(levels.size() == params.size());
+                for (size_t i = 0; i < levels.size(); ++i)
+                {
+                    REQUIRE_FALSE(levels[i] == nullptr);
+                    REQUIRE(levels[i]->get_num_map_squares() == params[i].width * params[i].height);
+                    REQUIRE(levels[i]->get_num_breaches() == 1UL);
+                }
+            }
+        }
+    }
+
+    GIVEN("A batch including params that can never be met")
+    {
+        std::vector<GenParams> params{
+                {10, 10, 1, 6, 1, 1, 1234},
+                {10, 10, 100, 200, 1, 1, 1234},
+        };
+
+        WHEN("generate_batch() is called")
+        {
+            const auto levels = generate_batch(params, 2);
+
+            THEN("nullptr is returned for only those params")
+            {
+                REQUIRE(levels.size() == 2UL);
+                REQUIRE_FALSE(levels[0] == nullptr);
+                REQUIRE(levels[1] == nullptr);
+            }
+        }
+    }
+
+    GIVEN("An empty batch")
+    {
+        THEN("no levels are returned")
+        {
+            REQUIRE(generate_batch({}, 4).empty());
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators_all.hpp>
+#include <chrono>
 #include <thread>
 #include "level_gen.h"
 
@@ -26,6 +27,7 @@ SCENARIO("level generators can be cancelled", "[levelgen][cancel]")
                 LevelGenerator gen{
                         20, 15, 12, 1, 6, 1, 1, 123456
                 };
+                gen.set_dump_models(true);
                 const char* res;
 
                 // This `current_n` is used by `check_cancel` to cancel the run after `current_n` checks
@@ -86,3 +88,216 @@ SCENARIO("level generators can be cancelled", "[levelgen][cancel]")
         }
     }
 }
+
+SCENARIO("level generators can be solved within a time budget", "[levelgen][cancel][budget]")
+{
+    GIVEN("A level generator for a small level")
+    {
+        LevelGenerator gen{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+
+        WHEN("solve_for() is called with a generous budget")
+        {
+            TimedSolveResult result{};
+            REQUIRE_NOTHROW(result = gen.solve_for(std::chrono::seconds(60)));
+
+            THEN("the optimal level is returned before the budget runs out")
+            {
+                REQUIRE_FALSE(result.level == nullptr);
+                REQUIRE_FALSE(result.timed_out);
+                REQUIRE(result.optimality_proven);
+                REQUIRE(result.level == gen.best_level());
+            }
+        }
+    }
+
+    GIVEN("A level generator for a large level, which has already been grounded")
+    {
+        LevelGenerator gen{
+                0, 24, 16, 3, 12, 2, 2, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve_for(0U));
+
+        WHEN("solve_for() is called with a short budget")
+        {
+            const auto start = std::chrono::steady_clock::now();
+            TimedSolveResult result{};
+            REQUIRE_NOTHROW(result = gen.solve_for(500U));
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            THEN("it returns soon after the budget runs out, with the best level found so far, if any")
+            {
+                REQUIRE(elapsed < std::chrono::seconds(5));
+                REQUIRE(result.timed_out);
+                REQUIRE_FALSE(result.optimality_proven);
+                REQUIRE(result.level == gen.best_level());
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can be solved in the background", "[levelgen][cancel][async]")
+{
+    GIVEN("A level generator for a small level")
+    {
+        LevelGenerator gen{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+
+        WHEN("solve_async() is called and polled until it finishes")
+        {
+            AsyncSolve* solve = nullptr;
+            REQUIRE_NOTHROW(solve = gen.solve_async());
+            REQUIRE_FALSE(solve == nullptr);
+
+            auto finished = false;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+            while (!finished && std::chrono::steady_clock::now() < deadline)
+            {
+                REQUIRE_NOTHROW(finished = solve->poll());
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            THEN("the optimal level is found, as if solved in the foreground")
+            {
+                REQUIRE(finished);
+                REQUIRE(solve->models_so_far() > 0);
+                REQUIRE(solve->models_so_far() == gen.get_num_levels());
+                REQUIRE_FALSE(solve->best() == nullptr);
+                REQUIRE(solve->best() == gen.best_level());
+                REQUIRE(gen.get_stats().optimality_proven);
+            }
+        }
+    }
+
+    GIVEN("A level generator for a large level")
+    {
+        LevelGenerator gen{
+                0, 24, 16, 3, 12, 2, 2, 1234
+        };
+
+        WHEN("a background solve is cancelled")
+        {
+            AsyncSolve* solve = gen.solve_async();
+            const auto finished = solve->wait(500U);
+            const auto* best = solve->best();
+            REQUIRE_NOTHROW(solve->cancel());
+
+            THEN("it stops, keeping the levels found so far, and the generator can solve again")
+            {
+                REQUIRE_FALSE(finished);
+                REQUIRE(solve->poll());
+                if (best)
+                {
+                    REQUIRE(solve->best() != nullptr);
+                    REQUIRE(solve->best()->get_cost() <= best->get_cost());
+                }
+
+                REQUIRE(gen.solve_async() == solve);
+                REQUIRE_NOTHROW(solve->cancel());
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can be cancelled with a token", "[levelgen][cancel][token]")
+{
+    GIVEN("A level generator for a large level, and a cancel token")
+    {
+        LevelGenerator gen{
+                0, 24, 16, 3, 12, 2, 2, 1234
+        };
+        CancelToken token;
+
+        WHEN("the token is cancelled before solving")
+        {
+            token.cancel();
+            REQUIRE_NOTHROW(gen.solve(token));
+
+            THEN("the solve stops before searching")
+            {
+                REQUIRE(token.is_cancelled());
+                REQUIRE(gen.get_num_levels() == 0);
+            }
+
+            AND_WHEN("the token is reset")
+            {
+                token.reset();
+
+                THEN("it no longer cancels the solve")
+                {
+                    REQUIRE_FALSE(token.is_cancelled());
+
+                    gen.set_inputs(1, 6, 1, 1, 1234);
+                    std::thread canceller([&]() {
+                        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+                        while (gen.get_num_levels() == 0 && std::chrono::steady_clock::now() < deadline)
+                        {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        }
+                        token.cancel();
+                    });
+                    REQUIRE_NOTHROW(gen.solve(token));
+                    canceller.join();
+
+                    REQUIRE(gen.get_num_levels() > 0);
+                }
+            }
+        }
+
+        WHEN("the token is cancelled from another thread during the search")
+        {
+            REQUIRE_NOTHROW(gen.solve_for(0U));  // Ground first, so only the search is cancelled
+
+            std::chrono::steady_clock::time_point cancelled_at;
+            std::thread canceller([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                cancelled_at = std::chrono::steady_clock::now();
+                token.cancel();
+            });
+
+            REQUIRE_NOTHROW(gen.solve(token));
+            const auto returned_at = std::chrono::steady_clock::now();
+            canceller.join();
+
+            THEN("solve() returns promptly, without waiting for the next level")
+            {
+                REQUIRE(returned_at - cancelled_at < std::chrono::seconds(1));
+            }
+        }
+    }
+
+    GIVEN("A level generator for a small level, and a cancel token")
+    {
+        LevelGenerator gen{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+        CancelToken token;
+
+        WHEN("the token is cancelled as each solve finishes")
+        {
+            THEN("the next solve is not interrupted")
+            {
+                // The search for a small level is short, so the cancel often lands as the search is closing
+                for (auto i = 0; i < 20; ++i)
+                {
+                    token.reset();
+                    std::thread canceller([&]() {
+                        while (gen.get_num_levels() == 0 && !token.is_cancelled())
+                        {
+                            std::this_thread::yield();
+                        }
+                        token.cancel();
+                    });
+                    REQUIRE_NOTHROW(gen.solve(token));
+                    token.cancel();  // In case the solve found nothing, so the canceller is still waiting
+                    canceller.join();
+
+                    REQUIRE_NOTHROW(gen.solve());
+                    REQUIRE(gen.get_num_levels() > 0);
+                }
+            }
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include "level_gen.h"
 
+#include <string>
+
 SCENARIO("level generators can be created", "[levelgen][creation]")
 {
     GIVEN("Nothing")
@@ -36,3 +38,31 @@ SCENARIO("level generators can be created", "[levelgen][creation]")
         }
     }
 }
+
+SCENARIO("level generators can override their solver config", "[levelgen][creation][config]")
+{
+    GIVEN("Config overrides")
+    {
+        WHEN("a level generator is created with valid overrides")
+        {
+            THEN("it can be solved")
+            {
+                LevelGenerator gen{
+                        1, 10, 10, 1, 6, 1, 1, ConfigMap{{"solver.restarts", "L,100"}, {"solver.heuristic", "Berkmin"}},
+                        1234
+                };
+                REQUIRE(std::string(gen.get_config_profile()) == "default");
+                REQUIRE_NOTHROW(gen.solve());
+                REQUIRE(gen.get_num_levels() == 1);
+            }
+        }
+
+        WHEN("a level generator is created with an unknown key")
+        {
+            THEN("it throws")
+            {
+                REQUIRE_THROWS(LevelGenerator(1, 10, 10, 1, 6, 1, 1, ConfigMap{{"solver.no_such_key", "1"}}));
+            }
+        }
+    }
+}
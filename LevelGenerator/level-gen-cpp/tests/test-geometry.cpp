@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+#include "level_gen.h"
+#include "ship_geometry.h"
+#include "clingo.hh"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    /// Ground a program, and collect the geometry atoms it derives as strings
+    std::set<std::string> ground_geometry(const std::string& program)
+    {
+        Clingo::Control solver;
+        solver.add("base", {}, program.c_str());
+        solver.ground({{"base", {}}});
+
+        std::set<std::string> atoms;
+        const auto symbolic_atoms = solver.symbolic_atoms();
+        for (const auto& signature : {Clingo::Signature("grid", 2), Clingo::Signature("in_space", 2),
+                                      Clingo::Signature("hull", 2), Clingo::Signature("ship", 2),
+                                      Clingo::Signature("room_anchor", 4), Clingo::Signature("breach_site", 6)})
+        {
+            for (auto it = symbolic_atoms.begin(signature); it != symbolic_atoms.end(); ++it)
+            {
+                atoms.insert(it->symbol().to_string());
+            }
+        }
+        return atoms;
+    }
+}
+
+SCENARIO("the ship geometry computed in C++ matches geometry.lp", "[levelgen][geometry]")
+{
+    GIVEN("A grid size")
+    {
+        auto width = GENERATE(values({9U, 12U, 16U, 32U}));
+        auto height = GENERATE(values({10U, 16U, 24U}));
+
+        WHEN("the geometry is computed both ways")
+        {
+            std::ifstream file(LEVEL_GEN_PROGRAMS_DIR "/geometry.lp");
+            REQUIRE(file.is_open());
+            std::ostringstream program;
+            program << file.rdbuf() << std::endl
+                    << "#const width = " << width << "." << std::endl
+                    << "#const height = " << height << "." << std::endl;
+
+            THEN("the same atoms are derived")
+            {
+                const auto expected = ground_geometry(program.str());
+                REQUIRE_FALSE(expected.empty());
+                REQUIRE(ground_geometry(ShipGeometry(width, height).facts()) == expected);
+            }
+        }
+    }
+}
+
+SCENARIO("solved levels place their rooms and breaches by the ship geometry", "[levelgen][geometry]")
+{
+    GIVEN("A solved level")
+    {
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 2, 1, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        const auto* level = gen.best_level();
+        REQUIRE_FALSE(level == nullptr);
+        const ShipGeometry geometry(level->get_width(), level->get_height());
+
+        WHEN("its rooms are checked against the geometry")
+        {
+            THEN("rooms and corridors lie entirely within the ship, and breaches cross the hull from space")
+            {
+                auto room_iter = level->rooms();
+                while (room_iter.move_next())
+                {
+                    const auto rm = room_iter.current();
+                    size_t num_ship = 0, num_hull = 0, num_space = 0;
+                    for (auto y = rm.y; y < rm.y + rm.h; ++y)
+                    {
+                        for (auto x = rm.x; x < rm.x + rm.w; ++x)
+                        {
+                            const auto sx = static_cast<int>(x), sy = static_cast<int>(y);
+                            num_ship += geometry.is(sx, sy, ShipGeometry::Square::Ship) ? 1 : 0;
+                            num_hull += geometry.is(sx, sy, ShipGeometry::Square::Hull) ? 1 : 0;
+                            num_space += geometry.is(sx, sy, ShipGeometry::Square::Space) ? 1 : 0;
+                        }
+                    }
+
+                    if (rm.type == RoomType::AlienBreach)
+                    {
+                        REQUIRE(rm.w * rm.h == 2U);
+                        REQUIRE(num_hull == 1UL);
+                        REQUIRE(num_space == 1UL);
+                    }
+                    else
+                    {
+                        REQUIRE(num_ship == static_cast<size_t>(rm.w) * rm.h);
+                    }
+                }
+            }
+        }
+    }
+}
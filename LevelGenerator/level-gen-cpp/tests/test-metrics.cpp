@@ -0,0 +1,63 @@
+#include <catch2/catch_test_macros.hpp>
+#include "level_gen.h"
+
+SCENARIO("levels can be scored by quality metrics", "[levelgen][metrics]")
+{
+    GIVEN("A generated level")
+    {
+        LevelGenerator gen{
+                1, 14, 12, 3, 8, 2, 1, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        const auto* level = gen.best_level();
+        REQUIRE_FALSE(level == nullptr);
+
+        WHEN("its metrics are calculated")
+        {
+            const LevelMetrics metrics(*level);
+
+            THEN("each metric is within its normalised range")
+            {
+                REQUIRE(metrics.density > 0.0);
+                REQUIRE(metrics.density <= 1.0);
+                REQUIRE(metrics.room_count > 0.0);
+                REQUIRE(metrics.room_count <= 1.0);
+                REQUIRE(metrics.average_room_size > 0.0);
+                REQUIRE(metrics.average_room_size <= 1.0);
+                REQUIRE(metrics.map_linearity > 0.0);
+                REQUIRE(metrics.map_linearity <= 1.0);
+                REQUIRE(metrics.path_redundancy >= 0.0);
+                REQUIRE(metrics.path_redundancy < 1.0);
+                REQUIRE(metrics.exploration >= 0.0);
+                REQUIRE(metrics.exploration <= 2.0);
+                REQUIRE(metrics.proximity_to_danger >= 0.0);
+                REQUIRE(metrics.proximity_to_danger <= 1.0);
+            }
+
+            THEN("breached rooms are treated as dangerous, so the path is not maximally safe")
+            {
+                // Every room is reachable, so each room on the path is closer to danger than the number of rooms
+                REQUIRE(metrics.proximity_to_danger < 1.0);
+            }
+        }
+
+        WHEN("the level is serialized and read back")
+        {
+            const auto data = level->serialize();
+            const auto read = Level::deserialize(data.data(), data.size());
+            const LevelMetrics original(*level);
+            const LevelMetrics metrics(*read);
+
+            THEN("its metrics are unchanged")
+            {
+                REQUIRE(metrics.density == original.density);
+                REQUIRE(metrics.exploration == original.exploration);
+                REQUIRE(metrics.map_linearity == original.map_linearity);
+                REQUIRE(metrics.path_redundancy == original.path_redundancy);
+                REQUIRE(metrics.proximity_to_danger == original.proximity_to_danger);
+                REQUIRE(metrics.average_room_size == original.average_room_size);
+                REQUIRE(metrics.room_count == original.room_count);
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include "level_gen.h"
+
+SCENARIO("level pools can be filled and taken from", "[levelgen][pool]")
+{
+    GIVEN("A level pool with valid params")
+    {
+        LevelPool pool{
+                2, 10, 10, 1, 6, 1, 1
+        };
+
+        WHEN("take() is called with a timeout")
+        {
+            THEN("a level is returned")
+            {
+                const Level* level = nullptr;
+                REQUIRE_NOTHROW(level = pool.take(60000));
+                REQUIRE_FALSE(level == nullptr);
+                REQUIRE(level->get_num_map_squares() == 100UL);
+                REQUIRE(level->get_num_breaches() == 1UL);
+                REQUIRE(level->get_num_portals() == 2UL);  // One entry each way
+            }
+
+            THEN("the pool is refilled up to its capacity")
+            {
+                REQUIRE_FALSE(pool.take(60000) == nullptr);
+                REQUIRE_FALSE(pool.take(60000) == nullptr);
+                REQUIRE_FALSE(pool.take(60000) == nullptr);
+                REQUIRE(pool.get_num_ready() <= 2UL);
+            }
+        }
+
+        WHEN("the pool is stopped")
+        {
+            REQUIRE_NOTHROW(pool.stop());
+
+            THEN("no more levels than its capacity can be taken")
+            {
+                auto num_taken = 0UL;
+                while (pool.try_take() != nullptr)
+                {
+                    ++num_taken;
+                }
+                REQUIRE(num_taken <= 2UL);
+                REQUIRE(pool.take(10) == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A level pool for a large level")
+    {
+        LevelPool pool{
+                2, 24, 16, 3, 12, 2, 2
+        };
+
+        WHEN("the pool is stopped while its workers are still grounding")
+        {
+            const auto start = std::chrono::steady_clock::now();
+            REQUIRE_NOTHROW(pool.stop());
+
+            THEN("stop() returns once grounding finishes, without searching")
+            {
+                REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(30));
+                REQUIRE(pool.take(10) == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A level pool with params that can never be met")
+    {
+        LevelPool pool{
+                2, 10, 10, 100, 200, 1, 1
+        };
+
+        WHEN("take() is called with a timeout")
+        {
+            THEN("nullptr is returned without waiting for the timeout")
+            {
+                const auto start = std::chrono::steady_clock::now();
+                REQUIRE(pool.take(60000) == nullptr);
+                REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(30));
+            }
+        }
+    }
+}
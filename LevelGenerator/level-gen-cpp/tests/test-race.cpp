@@ -0,0 +1,98 @@
+#include <catch2/catch_test_macros.hpp>
+#include <limits>
+#include "level_gen.h"
+
+SCENARIO("racing level generators return the first good enough level", "[levelgen][race]")
+{
+    GIVEN("A racing level generator with valid params")
+    {
+        RacingLevelGenerator racer{
+                4, 5, 10, 10, 1, 6, 1, 1, 1234
+        };
+        REQUIRE(racer.get_num_racers() == 4U);
+
+        WHEN("solve() is called without a cost threshold")
+        {
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = racer.solve());
+
+            THEN("the first level found wins")
+            {
+                REQUIRE_FALSE(level == nullptr);
+                REQUIRE(racer.get_winner() >= 0);
+                REQUIRE(racer.get_winner() < 4);
+                REQUIRE(level->get_num_map_squares() == 100UL);
+                REQUIRE(level->get_num_breaches() == 1UL);
+                REQUIRE(level->get_num_portals() == 2UL);  // One entry each way
+            }
+        }
+
+        WHEN("solve() is called with a cost threshold that can never be met")
+        {
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = racer.solve(std::numeric_limits<int>::min()));
+
+            THEN("the best level from any racer is returned")
+            {
+                REQUIRE_FALSE(level == nullptr);
+                REQUIRE(racer.get_winner() >= 0);
+            }
+        }
+
+        WHEN("solve() is called more than once")
+        {
+            REQUIRE_FALSE(racer.solve() == nullptr);
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = racer.solve());
+
+            THEN("a level is returned each time")
+            {
+                REQUIRE_FALSE(level == nullptr);
+            }
+        }
+
+        WHEN("solve() is called again after a race is won")
+        {
+            REQUIRE_FALSE(racer.solve() == nullptr);
+
+            THEN("the racers are not interrupted before they find a level, even those that finished first")
+            {
+                // No racer can win this one, so each only stops once its search finishes
+                const Level* level = nullptr;
+                REQUIRE_NOTHROW(level = racer.solve(std::numeric_limits<int>::min()));
+                REQUIRE_FALSE(level == nullptr);
+                REQUIRE(racer.get_winner() >= 0);
+            }
+        }
+
+        WHEN("it is interrupted just before solve() is called")
+        {
+            racer.interrupt();
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = racer.solve());
+
+            THEN("that solve is stopped, but the next one is not")
+            {
+                REQUIRE(level == nullptr);
+                REQUIRE(racer.get_winner() == -1);
+                REQUIRE_FALSE(racer.solve() == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A racing level generator with params that can never be met")
+    {
+        RacingLevelGenerator racer{
+                2, 1, 10, 10, 100, 200, 1, 1
+        };
+
+        WHEN("solve() is called")
+        {
+            THEN("nullptr is returned")
+            {
+                REQUIRE(racer.solve() == nullptr);
+                REQUIRE(racer.get_winner() == -1);
+            }
+        }
+    }
+}
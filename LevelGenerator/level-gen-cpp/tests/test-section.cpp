@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <thread>
+#include "level_gen.h"
+
+SCENARIO("large levels can be generated in sections", "[levelgen][section]")
+{
+    GIVEN("A sectioned level generator with valid params")
+    {
+        SectionedLevelGenerator gen{
+                1, 32, 24, 4, 20, 2, 1, 1234, 12
+        };
+        REQUIRE(gen.get_num_sections() > 1U);
+
+        WHEN("solve() is called")
+        {
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = gen.solve());
+
+            THEN("the sections are stitched together into a single level that meets the inputs")
+            {
+                REQUIRE_FALSE(level == nullptr);
+                REQUIRE(level->get_width() == 32U);
+                REQUIRE(level->get_height() == 24U);
+                REQUIRE(level->get_num_map_squares() == 32UL * 24UL);
+                REQUIRE(level->get_num_breaches() == 2UL);
+                REQUIRE(level->get_num_portals() == 2UL);  // One entry each way
+                REQUIRE(level->get_num_corridors() >= 3UL);
+                REQUIRE(level->get_start_room() != level->get_finish_room());
+
+                const auto num_rooms = level->get_num_rooms();
+                const auto num_restricted_rooms = num_rooms - level->get_num_corridors() - level->get_num_breaches();
+                REQUIRE(num_restricted_rooms >= 4UL);
+                REQUIRE(num_restricted_rooms <= 20UL);
+
+                // Every room must have at least one door, including across the section boundaries
+                REQUIRE(level->get_num_doors() >= num_rooms);
+            }
+        }
+
+        WHEN("solve() is called more than once")
+        {
+            REQUIRE_FALSE(gen.solve() == nullptr);
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = gen.solve());
+
+            THEN("a level is returned each time")
+            {
+                REQUIRE_FALSE(level == nullptr);
+            }
+        }
+
+        WHEN("it is interrupted just before solve() is called")
+        {
+            gen.interrupt();
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = gen.solve());
+
+            THEN("that solve is stopped, but the next one is not")
+            {
+                REQUIRE(level == nullptr);
+                REQUIRE_FALSE(gen.solve() == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A sectioned level generator with params that can never be met")
+    {
+        SectionedLevelGenerator gen{
+                1, 32, 24, 200, 400, 2, 1, 1234, 12
+        };
+
+        WHEN("solve() is called")
+        {
+            const Level* level = nullptr;
+            REQUIRE_NOTHROW(level = gen.solve());
+
+            THEN("no level is returned")
+            {
+                REQUIRE(level == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A sectioned level generator for a large level")
+    {
+        SectionedLevelGenerator gen{
+                0, 64, 64, 40, 120, 4, 3, 1234
+        };
+
+        WHEN("it is interrupted from another thread")
+        {
+            std::thread interrupter([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                gen.interrupt();
+            });
+
+            const auto start = std::chrono::steady_clock::now();
+            REQUIRE_NOTHROW(gen.solve());
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            interrupter.join();
+
+            THEN("solve() returns soon after")
+            {
+                REQUIRE(elapsed < std::chrono::seconds(10));
+            }
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include "level_gen.h"
+
+namespace
+{
+    template<class T>
+    std::vector<T> all_parts(LevelPartIter<T> iter)
+    {
+        iter.reset();
+        std::vector<T> ret;
+        while (iter.move_next())
+        {
+            ret.push_back(iter.current());
+        }
+        return ret;
+    }
+
+    void require_same_level(const Level& first, const Level& second)
+    {
+        REQUIRE(first.get_cost() == second.get_cost());
+        REQUIRE(first.get_width() == second.get_width());
+        REQUIRE(first.get_height() == second.get_height());
+        REQUIRE(first.get_num_map_squares() == second.get_num_map_squares());
+        REQUIRE(first.get_num_corridors() == second.get_num_corridors());
+        REQUIRE(first.get_num_breaches() == second.get_num_breaches());
+        REQUIRE(first.get_start_room() == second.get_start_room());
+        REQUIRE(first.get_finish_room() == second.get_finish_room());
+
+        const auto num_squares = static_cast<size_t>(first.get_width()) * first.get_height();
+        REQUIRE(std::equal(first.grid_squares(), first.grid_squares() + num_squares, second.grid_squares()));
+
+        REQUIRE(all_parts(first.rooms()) == all_parts(second.rooms()));
+        REQUIRE(all_parts(first.doors()) == all_parts(second.doors()));
+        REQUIRE(all_parts(first.portals()) == all_parts(second.portals()));
+    }
+}
+
+SCENARIO("levels can be serialized", "[levelgen][serialize]")
+{
+    GIVEN("A solved level")
+    {
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 2, 1, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        const auto* level = gen.best_level();
+        REQUIRE_FALSE(level == nullptr);
+
+        WHEN("it is serialized and deserialized")
+        {
+            const auto data = level->serialize();
+            std::unique_ptr<Level> copy;
+            REQUIRE_NOTHROW(copy = Level::deserialize(data.data(), data.size()));
+
+            THEN("the copy matches the original")
+            {
+                REQUIRE_FALSE(copy == nullptr);
+                require_same_level(*level, *copy);
+            }
+
+            THEN("the serialized form is compact")
+            {
+                // One byte per square, plus the rooms and connections, is much smaller than the squares in memory
+                REQUIRE(data.size() < level->get_num_map_squares() * sizeof(MapSquare));
+            }
+
+            THEN("the level in memory is about as compact as its serialized form, even once its parts are iterated")
+            {
+                // Only a fixed overhead on top of the serialized data, and a few bytes per room, as rooms are aligned
+                const auto max_size = data.size() + level->get_num_rooms() * 4 + 256;
+                REQUIRE(level->get_memory_size() <= max_size);
+                REQUIRE(copy->get_memory_size() <= max_size);
+
+                REQUIRE(all_parts(level->map_squares()).size() == level->get_num_map_squares());
+                REQUIRE(all_parts(level->rooms()).size() == level->get_num_rooms());
+                REQUIRE(level->get_memory_size() <= max_size);
+            }
+
+            THEN("the copy has the same level text")
+            {
+                REQUIRE(std::string(copy->get_level_text()) == level->get_level_text());
+            }
+        }
+
+        WHEN("invalid data is deserialized")
+        {
+            auto data = level->serialize();
+
+            THEN("truncated data is rejected")
+            {
+                REQUIRE_THROWS(Level::deserialize(data.data(), data.size() - 1));
+            }
+
+            THEN("data with the wrong version is rejected")
+            {
+                data[4] = 0xFF;
+                REQUIRE_THROWS(Level::deserialize(data.data(), data.size()));
+            }
+
+            THEN("data with a room ID of zero is rejected")
+            {
+                // The start room ID follows the magic, version, size, cost and counts, all 16-bit apart from the cost
+                data[20] = 0;
+                data[21] = 0;
+                REQUIRE_THROWS(Level::deserialize(data.data(), data.size()));
+            }
+
+            THEN("data with a door to room zero is rejected")
+            {
+                // The first door follows the header, the grid and the rooms, which take 7 bytes each
+                REQUIRE(level->get_num_doors() > 0);
+                const auto first_door = 24 + static_cast<size_t>(level->get_width()) * level->get_height()
+                                        + level->get_num_rooms() * 7;
+                data[first_door] = 0;
+                data[first_door + 1] = 0;
+                REQUIRE_THROWS(Level::deserialize(data.data(), data.size()));
+            }
+        }
+
+        WHEN("it is written to a level pack file")
+        {
+            const auto* path = "test-level-pack.bin";
+            REQUIRE_NOTHROW(LevelPack::write(path, {level, level}));
+
+            THEN("the pack can be opened and the levels loaded")
+            {
+                {
+                    LevelPack pack{path};
+                    REQUIRE(pack.get_num_levels() == 2UL);
+
+                    const auto* loaded = pack.load_level(1);
+                    REQUIRE_FALSE(loaded == nullptr);
+                    require_same_level(*level, *loaded);
+
+                    REQUIRE_THROWS(pack.load_level(2));
+                    REQUIRE_THROWS(pack.read_level(2));
+                }
+                std::remove(path);
+            }
+        }
+
+        WHEN("a level pack claims more levels than its index holds")
+        {
+            // Magic, version, reserved, then a count of 0xFFFFFFFF with only one index entry after it
+            std::vector<uint8_t> data{'W', 'S', 'P', 'K', 1, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+            data.resize(data.size() + 16, 0);
+
+            THEN("it is rejected as invalid")
+            {
+                REQUIRE_THROWS_AS(LevelPack(data.data(), data.size()), std::runtime_error);
+            }
+        }
+    }
+}
+
+SCENARIO("level parts can be read from several threads", "[levelgen][serialize][threads]")
+{
+    GIVEN("Two copies of a solved level")
+    {
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 2, 1, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        const auto data = gen.best_level()->serialize();
+        const auto first = Level::deserialize(data.data(), data.size());
+        const auto second = Level::deserialize(data.data(), data.size());
+
+        WHEN("the parts of one are first read from several threads at once")
+        {
+            // Parts are stored packed, and only expanded when first read
+            std::vector<size_t> num_rooms(4, 0);
+            std::vector<std::thread> readers;
+            for (size_t i = 0; i < num_rooms.size(); ++i)
+            {
+                readers.emplace_back([&, i]() { num_rooms[i] = all_parts(first->rooms()).size(); });
+            }
+            for (auto& reader : readers)
+            {
+                reader.join();
+            }
+
+            THEN("every thread sees the same parts")
+            {
+                for (const auto count : num_rooms)
+                {
+                    REQUIRE(count == first->get_num_rooms());
+                }
+                require_same_level(*first, *second);
+            }
+        }
+    }
+}
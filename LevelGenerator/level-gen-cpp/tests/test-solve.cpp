@@ -2,6 +2,10 @@
 #include <catch2/generators/catch_generators_all.hpp>
 #include "level_gen.h"
 
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
 namespace
 {
     template<class T>
@@ -35,6 +39,16 @@ namespace
         return sum;
     }
 
+    thread_local std::vector<int> level_costs;
+    thread_local std::vector<size_t> level_indices;
+
+    void record_level(const Level& level, int cost, size_t index)
+    {
+        REQUIRE(level.get_cost() == cost);
+        level_costs.push_back(cost);
+        level_indices.push_back(index);
+    }
+
     template<class T>
     std::vector<T> accumulate_parts(LevelPartIter<T> iter, std::function<bool(const T&)> filter)
     {
@@ -65,13 +79,60 @@ SCENARIO("level generators can be solved", "[levelgen][solve]")
                 LevelGenerator gen{
                         1, 9, 10, 1, 6, 1, 0, 1234
                 };
+                gen.set_dump_models(true);
                 const char* res;
                 REQUIRE_NOTHROW(res = gen.solve());
                 REQUIRE_FALSE(res == nullptr);
-                REQUIRE_FALSE(std::string(res).empty());
+                REQUIRE(std::string(res).find("Model: ") == 0);
+                REQUIRE(std::string(res).find(" room(") != std::string::npos);
                 REQUIRE(gen.get_num_levels() == 1);
             }
 
+            THEN("no model text is returned by default, but the text of each level is available")
+            {
+                LevelGenerator gen{
+                        1, 9, 10, 1, 6, 1, 0, 1234
+                };
+                const char* res;
+                REQUIRE_NOTHROW(res = gen.solve());
+                REQUIRE_FALSE(res == nullptr);
+                REQUIRE(std::string(res).empty());
+
+                const auto* level = gen.best_level();
+                REQUIRE_FALSE(level == nullptr);
+                const auto text = std::string(level->get_level_text());
+                REQUIRE(text.find("Level: ") == 0);
+                REQUIRE(text.find("room(") != std::string::npos);
+            }
+
+            THEN("the level text can be read from several threads at once")
+            {
+                LevelGenerator gen{
+                        1, 9, 10, 1, 6, 1, 0, 1234
+                };
+                REQUIRE_NOTHROW(gen.solve());
+                const auto* level = gen.best_level();
+                REQUIRE_FALSE(level == nullptr);
+
+                std::vector<const char*> texts(4, nullptr);
+                std::vector<std::thread> readers;
+                for (size_t i = 0; i < texts.size(); ++i)
+                {
+                    readers.emplace_back([&, i]() { texts[i] = level->get_level_text(); });
+                }
+                for (auto& reader : readers)
+                {
+                    reader.join();
+                }
+
+                // Formatted once, so every thread gets the same text
+                for (const auto* text : texts)
+                {
+                    REQUIRE(text == texts.front());
+                }
+                REQUIRE(std::string(texts.front()).find("Level: ") == 0);
+            }
+
             THEN("a best level exists")
             {
                 LevelGenerator gen{
@@ -98,6 +159,19 @@ SCENARIO("level generators can be solved", "[levelgen][solve]")
                 REQUIRE(level->get_num_map_squares() == 90UL);
                 REQUIRE(level->get_num_rooms() == 7UL);
                 REQUIRE(level->get_num_doors() == 16UL);
+
+                // And these hold for any valid level
+                const auto num_rooms = level->get_num_rooms();
+                const auto num_restricted_rooms = num_rooms - level->get_num_corridors() - level->get_num_breaches();
+                REQUIRE(num_restricted_rooms >= 1UL);
+                REQUIRE(num_restricted_rooms <= 6UL);
+                REQUIRE(level->get_num_corridors() >= 3UL);
+                REQUIRE(level->get_num_breaches() == 1UL);
+                REQUIRE(level->get_num_portals() == 0UL);
+
+                // Every room must have at least one door, and doors are listed both ways
+                REQUIRE(level->get_num_doors() >= num_rooms);
+                REQUIRE(level->get_num_doors() % 2 == 0UL);
             }
 
             THEN("the best level can iterate over symbols")
@@ -116,6 +190,53 @@ SCENARIO("level generators can be solved", "[levelgen][solve]")
                 REQUIRE(count_parts(level->doors()) == 16UL);
             }
 
+            THEN("the best level can copy its parts in bulk")
+            {
+                LevelGenerator gen{
+                        1, 9, 10, 1, 2, 1, 1, 1234
+                };
+                REQUIRE_NOTHROW(gen.solve());
+
+                const auto* level = gen.best_level();
+                REQUIRE_FALSE(level == nullptr);
+
+                const auto rooms = level->rooms();
+                std::vector<Room> room_copy(rooms.count(), Room{0, 0, 0, 0, RoomType::Unknown});
+                REQUIRE(rooms.copy_to(room_copy.data(), room_copy.size()) == level->get_num_rooms());
+                REQUIRE(room_copy == accumulate_parts<Room>(rooms, [](const auto&) { return true; }));
+
+                const auto doors = level->doors();
+                std::vector<Door> door_copy(doors.count(), Door{0, 0});
+                REQUIRE(doors.copy_to(door_copy.data(), door_copy.size()) == level->get_num_doors());
+                REQUIRE(door_copy == accumulate_parts<Door>(doors, [](const auto&) { return true; }));
+
+                // Copies are limited by capacity
+                std::vector<Portal> portal_copy(1, Portal{0, 0});
+                REQUIRE(level->portals().copy_to(portal_copy.data(), portal_copy.size()) == 1UL);
+            }
+
+            THEN("the best level has a square grid matching its map squares")
+            {
+                LevelGenerator gen{
+                        1, 9, 10, 1, 6, 1, 0, 1234
+                };
+                REQUIRE_NOTHROW(gen.solve());
+
+                const auto* level = gen.best_level();
+                REQUIRE_FALSE(level == nullptr);
+
+                const auto* grid = level->grid_squares();
+                REQUIRE_FALSE(grid == nullptr);
+
+                auto iter = level->map_squares();
+                while (iter.move_next())
+                {
+                    const auto sq = iter.current();
+                    const auto index = (sq.y - 1) * level->get_width() + (sq.x - 1);
+                    REQUIRE(grid[index] == static_cast<uint8_t>(sq.type));
+                }
+            }
+
             THEN("the best level has the right number of breaches")
             {
                 LevelGenerator gen{
@@ -158,9 +279,478 @@ SCENARIO("level generators can be solved", "[levelgen][solve]")
 
                 const auto* level = gen.best_level();
                 REQUIRE_FALSE(level == nullptr);
+
                 REQUIRE(level->get_num_rooms() == 11UL);
                 REQUIRE(level->get_start_room() == 4UL);
                 REQUIRE(level->get_finish_room() == 5UL);
+
+                // Room IDs are one-based, and the start and finish rooms must differ
+                const auto num_rooms = level->get_num_rooms();
+                REQUIRE(level->get_start_room() >= 1UL);
+                REQUIRE(level->get_start_room() <= num_rooms);
+                REQUIRE(level->get_finish_room() >= 1UL);
+                REQUIRE(level->get_finish_room() <= num_rooms);
+                REQUIRE(level->get_start_room() != level->get_finish_room());
+
+                // Neither is a corridor or a breach
+                auto room_iter = level->rooms();
+                while (room_iter.move_next())
+                {
+                    const auto rm = room_iter.current();
+                    if (rm.room_id == level->get_start_room() || rm.room_id == level->get_finish_room())
+                    {
+                        REQUIRE(rm.type != RoomType::Corridor);
+                        REQUIRE(rm.type != RoomType::AlienBreach);
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can be solved more than once", "[levelgen][solve][reuse]")
+{
+    GIVEN("A level generator that has already been solved")
+    {
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 1, 0, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        REQUIRE(gen.get_num_levels() == 1);
+
+        WHEN("its inputs are changed and solve() is called again")
+        {
+            gen.set_inputs(2, 4, 2, 1, 4321);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("the best level meets the new inputs")
+            {
+                REQUIRE(gen.get_num_levels() == 1);
+
+                const auto* level = gen.best_level();
+                REQUIRE_FALSE(level == nullptr);
+
+                const auto num_restricted_rooms =
+                        level->get_num_rooms() - level->get_num_corridors() - level->get_num_breaches();
+                REQUIRE(num_restricted_rooms >= 2UL);
+                REQUIRE(num_restricted_rooms <= 4UL);
+                REQUIRE(level->get_num_breaches() == 2UL);
+                REQUIRE(level->get_num_portals() == 2UL);  // One entry each way
+            }
+        }
+
+        WHEN("its inputs are changed to values that can never fit the grid")
+        {
+            gen.set_inputs(100, 200, 1, 0);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("no levels are generated")
+            {
+                REQUIRE(gen.get_num_levels() == 0);
+                REQUIRE(gen.best_level() == nullptr);
+            }
+        }
+    }
+}
+
+SCENARIO("level generators report each level as it is found", "[levelgen][solve][callback]")
+{
+    GIVEN("A level generator with a level callback")
+    {
+        LevelGenerator gen{
+                5, 10, 10, 1, 6, 1, 1, 1234
+        };
+        gen.set_level_callback(record_level);
+        level_costs.clear();
+        level_indices.clear();
+
+        WHEN("solve() is called")
+        {
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("the callback is called once per level, in order, with improving costs")
+            {
+                REQUIRE(level_costs.size() == gen.get_num_levels());
+                for (size_t i = 0; i < level_indices.size(); ++i)
+                {
+                    REQUIRE(level_indices[i] == i);
+                }
+                for (size_t i = 1; i < level_costs.size(); ++i)
+                {
+                    REQUIRE(level_costs[i] <= level_costs[i - 1]);
+                }
+                REQUIRE(level_costs.back() == gen.best_level()->get_cost());
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can race threads with different configurations", "[levelgen][solve][compete]")
+{
+    GIVEN("A level generator in compete mode with the default portfolio")
+    {
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 1, 1, 1234, false, 4, ParallelMode::Compete
+        };
+
+        WHEN("solve() is called")
+        {
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("a level is generated")
+            {
+                REQUIRE(gen.get_num_levels() == 1);
+                REQUIRE_FALSE(gen.best_level() == nullptr);
+            }
+        }
+    }
+
+    GIVEN("A level generator in compete mode with a portfolio file")
+    {
+        const auto* path = "test-portfolio.txt";
+        {
+            std::ofstream portfolio(path);
+            portfolio << "[first]: --heuristic=vsids --restarts=L,100" << std::endl
+                      << "[second](jumpy): --heuristic=berkmin" << std::endl;
+        }
+        LevelGenerator gen{
+                1, 12, 10, 1, 6, 1, 1, 1234, false, 2, ParallelMode::Compete, path
+        };
+
+        WHEN("solve() is called")
+        {
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("a level is generated")
+            {
+                REQUIRE(gen.get_num_levels() == 1);
+            }
+        }
+        std::remove(path);
+    }
+
+    GIVEN("A portfolio file that does not exist")
+    {
+        THEN("creating a level generator in compete mode throws")
+        {
+            REQUIRE_THROWS(LevelGenerator(1, 12, 10, 1, 6, 1, 1, 1234, false, 2, ParallelMode::Compete,
+                                          "no-such-portfolio.txt"));
+        }
+    }
+}
+
+SCENARIO("level generators report statistics for each solve", "[levelgen][solve][stats]")
+{
+    GIVEN("A level generator that has not been solved")
+    {
+        LevelGenerator gen{
+                5, 10, 10, 1, 6, 1, 1, 1234
+        };
+
+        THEN("all its statistics are empty")
+        {
+            const auto stats = gen.get_stats();
+            REQUIRE(stats.num_models == 0);
+            REQUIRE(stats.num_atoms == 0);
+            REQUIRE(stats.solve_time == 0.0);
+            REQUIRE_FALSE(stats.optimality_proven);
+        }
+
+        WHEN("solve() is called")
+        {
+            REQUIRE_NOTHROW(gen.solve());
+            const auto stats = gen.get_stats();
+
+            THEN("grounding and search statistics are returned")
+            {
+                REQUIRE(stats.parse_time > 0.0);
+                REQUIRE((stats.ground_time > 0.0 || stats.pregrounded));
+                REQUIRE(stats.solve_time > 0.0);
+                REQUIRE(stats.num_atoms > 0);
+                REQUIRE(stats.num_rules > 0);
+                REQUIRE(stats.num_choices > 0);
+                REQUIRE(stats.num_models == gen.get_num_levels());
+                REQUIRE(stats.first_model_time > 0.0);
+                REQUIRE(stats.first_model_time <= stats.best_model_time);
+                REQUIRE(stats.best_model_time <= stats.solve_time);
+            }
+
+            AND_WHEN("solve() is called again")
+            {
+                REQUIRE_NOTHROW(gen.solve());
+                const auto second_stats = gen.get_stats();
+
+                THEN("no time is spent grounding, but the ground program size is still reported")
+                {
+                    REQUIRE(second_stats.parse_time == 0.0);
+                    REQUIRE(second_stats.ground_time == 0.0);
+                    REQUIRE(second_stats.num_atoms == stats.num_atoms);
+                    REQUIRE(second_stats.num_rules == stats.num_rules);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can load a ground program built in for their size", "[levelgen][solve][preground]")
+{
+    GIVEN("A level generator using the embedded program, and one loading the program from file")
+    {
+        // The sizes pregrounded depend on the build, so this checks both generators agree either way
+        LevelGenerator embedded{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+        LevelGenerator from_file{
+                0, 10, 10, 1, 6, 1, 1, 1234, true
+        };
+        embedded.set_opt_mode(OptMode::ProveOptimal);
+        from_file.set_opt_mode(OptMode::ProveOptimal);
+
+        WHEN("both are solved to the optimum")
+        {
+            REQUIRE_NOTHROW(embedded.solve());
+            REQUIRE_NOTHROW(from_file.solve());
+            const auto embedded_stats = embedded.get_stats();
+            const auto from_file_stats = from_file.get_stats();
+
+            THEN("only the embedded program can be pregrounded, and both find levels of the same optimal cost")
+            {
+                REQUIRE_FALSE(from_file_stats.pregrounded);
+                if (embedded_stats.pregrounded)
+                {
+                    REQUIRE(embedded_stats.ground_time == 0.0);
+                }
+                REQUIRE(embedded_stats.optimality_proven);
+                REQUIRE(from_file_stats.optimality_proven);
+                REQUIRE_FALSE(embedded.best_level() == nullptr);
+                REQUIRE_FALSE(from_file.best_level() == nullptr);
+                REQUIRE(embedded.best_level()->get_cost() == from_file.best_level()->get_cost());
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can stop searching in different ways", "[levelgen][solve][optmode]")
+{
+    GIVEN("A level generator for a small level, and its optimal cost")
+    {
+        LevelGenerator gen{
+                20, 10, 10, 1, 6, 1, 1, 1234
+        };
+        gen.set_opt_mode(OptMode::ProveOptimal);
+        REQUIRE_NOTHROW(gen.solve());
+        REQUIRE(gen.get_stats().optimality_proven);
+        REQUIRE_FALSE(gen.best_level() == nullptr);
+        const auto optimal_cost = gen.best_level()->get_cost();
+
+        WHEN("solving for the first feasible level")
+        {
+            gen.set_opt_mode(OptMode::FirstFeasible);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("only one level is found")
+            {
+                REQUIRE(gen.get_num_levels() == 1);
+                REQUIRE(gen.best_level()->get_cost() >= optimal_cost);
+            }
+        }
+
+        WHEN("solving for a level at or below the optimal cost")
+        {
+            gen.set_opt_mode(OptMode::CostBound, optimal_cost);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("one level within the bound is found")
+            {
+                REQUIRE(gen.get_num_levels() == 1);
+                REQUIRE(gen.best_level()->get_cost() == optimal_cost);
+            }
+        }
+
+        WHEN("solving for a level below the optimal cost")
+        {
+            gen.set_opt_mode(OptMode::CostBound, optimal_cost - 1);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("no level is found")
+            {
+                REQUIRE(gen.get_num_levels() == 0);
+                REQUIRE(gen.best_level() == nullptr);
+            }
+        }
+
+        WHEN("enumerating optimal levels")
+        {
+            level_costs.clear();
+            gen.set_level_callback(record_level);
+            gen.set_opt_mode(OptMode::EnumerateOptimal);
+            REQUIRE_NOTHROW(gen.solve());
+
+            THEN("only optimal levels are found")
+            {
+                REQUIRE(gen.get_num_levels() > 0);
+                REQUIRE(gen.get_num_levels() <= 20);
+                REQUIRE(level_costs.size() == gen.get_num_levels());
+                for (const auto cost : level_costs)
+                {
+                    REQUIRE(cost == optimal_cost);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("level generators can keep only the best levels", "[levelgen][solve][retention]")
+{
+    GIVEN("A level generator that keeps every level, and one that keeps only the best")
+    {
+        LevelGenerator keep_all{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+        LevelGenerator keep_best{
+                0, 10, 10, 1, 6, 1, 1, 1234
+        };
+        keep_best.set_max_kept_levels(1);
+
+        WHEN("both are solved")
+        {
+            REQUIRE_NOTHROW(keep_all.solve());
+            level_costs.clear();
+            keep_best.set_level_callback(record_level);
+            REQUIRE_NOTHROW(keep_best.solve());
+
+            THEN("they find the same best level, but only the best is kept")
+            {
+                REQUIRE(keep_all.get_num_levels() > 1);
+                REQUIRE(keep_best.get_num_levels() == 1);
+                REQUIRE(level_costs.size() == keep_all.get_num_levels());
+                REQUIRE_FALSE(keep_best.best_level() == nullptr);
+                REQUIRE(keep_best.best_level()->get_cost() == keep_all.best_level()->get_cost());
+                REQUIRE(keep_best.best_level()->get_cost() == level_costs.back());
+            }
+
+            AND_WHEN("the generator keeping every level is limited")
+            {
+                const auto* best = keep_all.best_level();
+                keep_all.set_max_kept_levels(2);
+
+                THEN("the worst levels are dropped, but the best is kept in place")
+                {
+                    REQUIRE(keep_all.get_num_levels() == 2);
+                    REQUIRE(keep_all.best_level() == best);
+                }
+            }
+
+            AND_WHEN("the best levels are taken out of the generators")
+            {
+                const auto num_levels = keep_all.get_num_levels();
+                const auto best_cost = keep_all.best_level()->get_cost();
+                const auto taken = take_best_level(keep_all);
+                const auto taken_best = take_best_level(keep_best);
+
+                THEN("the generators no longer keep them, and the next best level takes their place")
+                {
+                    REQUIRE_FALSE(taken == nullptr);
+                    REQUIRE(taken->get_cost() == best_cost);
+                    REQUIRE(taken->get_num_map_squares() == 100UL);
+                    REQUIRE(keep_all.get_num_levels() == num_levels - 1);
+                    REQUIRE_FALSE(keep_all.best_level() == nullptr);
+                    REQUIRE(keep_all.best_level()->get_cost() >= best_cost);
+
+                    REQUIRE_FALSE(taken_best == nullptr);
+                    REQUIRE(keep_best.get_num_levels() == 0);
+                    REQUIRE(keep_best.best_level() == nullptr);
+                    REQUIRE(take_best_level(keep_best) == nullptr);
+                }
+            }
+        }
+
+        WHEN("the generator keeping only the best is solved in the background")
+        {
+            AsyncSolve* solve = keep_best.solve_async();
+            std::vector<const Level*> seen;
+            while (!solve->poll())
+            {
+                const auto* level = solve->best();
+                if (level && (seen.empty() || seen.back() != level))
+                {
+                    seen.push_back(level);
+                }
+            }
+
+            THEN("every level handed out stays valid until the next solve, even once replaced")
+            {
+                REQUIRE(keep_best.get_num_levels() == 1);
+                const auto best_cost = keep_best.best_level()->get_cost();
+                for (const auto* level : seen)
+                {
+                    REQUIRE(level->get_cost() >= best_cost);
+                    REQUIRE(level->get_num_map_squares() == 100UL);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("level generators lay out the ship within its hull", "[levelgen][solve][geometry]")
+{
+    GIVEN("A solved level")
+    {
+        LevelGenerator gen{
+                1, 16, 12, 2, 8, 2, 1, 1234
+        };
+        REQUIRE_NOTHROW(gen.solve());
+        const auto* level = gen.best_level();
+        REQUIRE_FALSE(level == nullptr);
+
+        const auto width = static_cast<int>(level->get_width());
+        const auto height = static_cast<int>(level->get_height());
+        const auto square_at = [&](int x, int y) {
+            if (x < 1 || y < 1 || x > width || y > height)
+            {
+                return SquareType::Space;
+            }
+            return static_cast<SquareType>(level->grid_squares()[(y - 1) * width + (x - 1)]);
+        };
+        const auto is_outside = [&](int x, int y) {
+            // Breaches start in space, so count as outside the ship
+            return square_at(x, y) == SquareType::Space || square_at(x, y) == SquareType::AlienBreach;
+        };
+
+        THEN("only space and breaches are on the edge of the map")
+        {
+            for (auto x = 1; x <= width; ++x)
+            {
+                REQUIRE(is_outside(x, 1));
+                REQUIRE(is_outside(x, height));
+            }
+            for (auto y = 1; y <= height; ++y)
+            {
+                REQUIRE(is_outside(1, y));
+                REQUIRE(is_outside(width, y));
+            }
+        }
+
+        THEN("every hull square borders space, and no other ship square does")
+        {
+            for (auto y = 1; y <= height; ++y)
+            {
+                for (auto x = 1; x <= width; ++x)
+                {
+                    const auto type = square_at(x, y);
+                    if (type == SquareType::Hull)
+                    {
+                        REQUIRE((is_outside(x, y - 1) || is_outside(x, y + 1)
+                                 || is_outside(x - 1, y) || is_outside(x + 1, y)));
+                    }
+                    else if (!is_outside(x, y))
+                    {
+                        REQUIRE_FALSE(square_at(x, y - 1) == SquareType::Space);
+                        REQUIRE_FALSE(square_at(x, y + 1) == SquareType::Space);
+                        REQUIRE_FALSE(square_at(x - 1, y) == SquareType::Space);
+                        REQUIRE_FALSE(square_at(x + 1, y) == SquareType::Space);
+                    }
+                }
             }
         }
     }
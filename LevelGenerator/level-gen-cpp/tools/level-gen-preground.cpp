@@ -0,0 +1,156 @@
+#include "aspif.h"
+#include "program.h"
+#include "ship_geometry.h"
+#include "clingo.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Size
+    {
+        unsigned width;
+        unsigned height;
+    };
+
+    void print_usage()
+    {
+        std::cerr << "Usage: level-gen-preground <out header> [WxH ...]" << std::endl
+                  << "  Grounds the embedded program for each grid size, and writes the ground programs to a header"
+                  << " as aspif, for the generator to load instead of grounding" << std::endl;
+    }
+
+    bool parse_options(int argc, char** argv, std::string& out_path, std::vector<Size>& sizes)
+    {
+        if (argc < 2)
+        {
+            return false;
+        }
+
+        out_path = argv[1];
+        for (auto i = 2; i < argc; ++i)
+        {
+            Size size{};
+            char separator = '\0';
+            if (std::sscanf(argv[i], "%u%c%u", &size.width, &separator, &size.height) != 3
+                || separator != 'x' || size.width == 0 || size.height == 0)
+            {
+                std::cerr << "Invalid size " << argv[i] << std::endl;
+                return false;
+            }
+            sizes.push_back(size);
+        }
+        return true;
+    }
+
+    /// Ground the program exactly as LevelGenerator does for the embedded program, recording it as aspif
+    std::string preground(const Size& size)
+    {
+        AspifWriter writer;
+        Clingo::Control solver;
+        solver.register_observer(writer);
+
+        std::ostringstream program;
+        program << ship_prog << std::endl << connections_prog;
+        solver.add("base", {}, program.str().c_str());
+
+        std::ostringstream inputs;
+        inputs
+                << "#const width = " << size.width << "." << std::endl
+                << "#const height = " << size.height << "." << std::endl;
+        solver.add("base", {}, inputs.str().c_str());
+        solver.add("base", {}, ShipGeometry(size.width, size.height).facts().c_str());
+        solver.ground({{"base", {}}});
+
+        // The inputs are not shown, but are assigned by symbol before each solve, so must keep their names
+        const auto atoms = solver.symbolic_atoms();
+        for (const auto* input : {"min_rooms", "max_rooms", "num_breaches", "num_portals"})
+        {
+            for (auto it = atoms.begin(Clingo::Signature(input, 1)); it != atoms.end(); ++it)
+            {
+                writer.name_atom(it->symbol(), it->literal());
+            }
+        }
+        return writer.finish();
+    }
+
+    /// Write the program as a char array, as MSVC limits the length of string literals
+    void write_array(std::ostream& out, const std::string& name, const std::string& aspif)
+    {
+        out << "const char " << name << "[] = {";
+        for (size_t i = 0; i < aspif.size(); ++i)
+        {
+            out << (i % 32 == 0 ? "\n        " : " ") << static_cast<int>(aspif[i]) << ",";
+        }
+        out << "\n        0\n};" << std::endl << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string out_path;
+    std::vector<Size> sizes;
+    if (!parse_options(argc, argv, out_path, sizes))
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::ostringstream header;
+    header << "#ifndef LEVELGENERATOR_PREGROUNDED_H" << std::endl
+           << "#define LEVELGENERATOR_PREGROUNDED_H" << std::endl << std::endl
+           << "// Generated by level-gen-preground - do not edit" << std::endl << std::endl
+           << "/// The ground program for a grid size, as aspif" << std::endl
+           << "struct PregroundedProgram {" << std::endl
+           << "    unsigned width;" << std::endl
+           << "    unsigned height;" << std::endl
+           << "    const char* aspif;" << std::endl
+           << "};" << std::endl << std::endl;
+
+    std::vector<std::string> names;
+    std::ostringstream header_entries;
+    for (const auto& size : sizes)
+    {
+        const auto name = "pregrounded_" + std::to_string(size.width) + "x" + std::to_string(size.height);
+        if (std::find(names.begin(), names.end(), name) != names.end())
+        {
+            continue;  // Listed twice
+        }
+
+        std::string aspif;
+        try
+        {
+            aspif = preground(size);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to ground " << size.width << "x" << size.height << ": " << e.what() << std::endl;
+            return 1;
+        }
+
+        write_array(header, name, aspif);
+        header_entries << "        {" << size.width << ", " << size.height << ", " << name << "}," << std::endl;
+        names.push_back(name);
+    }
+
+    // Terminated by an empty entry, so the table is valid even when no sizes are configured
+    header << "const PregroundedProgram pregrounded_programs[] = {" << std::endl
+           << header_entries.str()
+           << "        {0, 0, nullptr}" << std::endl
+           << "};" << std::endl << std::endl
+           << "#endif //LEVELGENERATOR_PREGROUNDED_H" << std::endl;
+
+    std::ofstream out(out_path);
+    if (!out.is_open() || !(out << header.str()))
+    {
+        std::cerr << "Failed to write " << out_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
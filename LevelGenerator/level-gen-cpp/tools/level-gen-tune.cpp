@@ -0,0 +1,334 @@
+#include "level_gen.h"
+#include "solver_config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Instance
+    {
+        unsigned width;
+        unsigned height;
+        unsigned min_rooms;
+        unsigned max_rooms;
+        unsigned num_breaches;
+        unsigned num_portals;
+        size_t seed;
+    };
+
+    /// Values to try for each key - these cover the options that piclasp tuned, apart from the fine-grained deletion
+    /// limits, which are kept from the base config
+    struct Param
+    {
+        const char* key;
+        std::vector<const char*> values;
+    };
+
+    const std::vector<Param> search_space{
+            {"configuration", {"jumpy", "tweety", "trendy", "frumpy", "crafty", "handy"}},
+            {"sat_prepro", {"no", "2"}},
+            {"asp.trans_ext", {"integ", "dynamic", "no"}},
+            {"asp.eq", {"0", "3", "5"}},
+            {"solver.heuristic", {"Vsids,94", "Vsids", "Berkmin", "Vmtf", "Domain"}},
+            {"solver.restarts", {"no", "L,100", "x,128,1.5", "D,100,0.7"}},
+            {"solver.local_restarts", {"0", "1"}},
+            {"solver.deletion", {"ipHeap,30,lbd", "basic,75", "ipSort,75,2"}},
+            {"solver.strengthen", {"recursive,all", "local", "no"}},
+            {"solver.sign_def", {"pos", "asp", "neg", "rnd"}},
+            {"solver.save_progress", {"0", "115", "180"}},
+            {"solver.init_moms", {"0", "1"}},
+            {"solver.lookahead", {"no", "atom"}},
+            {"solver.otfs", {"0", "1", "2"}},
+            {"solver.contraction", {"no", "120"}},
+    };
+
+    struct Candidate
+    {
+        SolverConfig config;
+        std::string path;
+        double total_score = 0.0;
+        size_t num_runs = 0;
+        bool failed = false;
+
+        double mean_score() const
+        {
+            return failed || num_runs == 0 ? std::numeric_limits<double>::infinity() : total_score / num_runs;
+        }
+    };
+
+    void set_value(SolverConfig& config, const std::string& key, const std::string& value)
+    {
+        const auto found = std::find_if(config.begin(), config.end(), [&](const auto& entry)
+        {
+            return entry.first == key;
+        });
+        if (found != config.end())
+        {
+            found->second = value;
+        }
+        else if (key == "configuration")
+        {
+            config.emplace(config.begin(), key, value);  // The base config must come first, as it resets the rest
+        }
+        else
+        {
+            config.emplace_back(key, value);
+        }
+    }
+
+    /// Parse "WxH:min_rooms,max_rooms,num_breaches,num_portals", returning false if it is not valid
+    bool parse_size(const char* arg, Instance& out)
+    {
+        return std::sscanf(arg, "%ux%u:%u,%u,%u,%u", &out.width, &out.height, &out.min_rooms, &out.max_rooms,
+                           &out.num_breaches, &out.num_portals) == 6;
+    }
+
+    struct Options
+    {
+        const char* base_path = "configs/tuned.cfg";
+        const char* out_path = "tuned.cfg";
+        unsigned num_candidates = 16;
+        unsigned num_seeds = 4;
+        unsigned max_num_levels = 1;
+        unsigned num_threads = 1;
+        unsigned rng_seed = 1;
+        double timeout_s = 10.0;
+        std::vector<Instance> sizes;
+    };
+
+    void print_usage()
+    {
+        std::cerr << "Usage: level-gen-tune [options]" << std::endl
+                  << "  --base <path>        Config to start from (default configs/tuned.cfg)" << std::endl
+                  << "  --out <path>         Where to write the winning config (default tuned.cfg)" << std::endl
+                  << "  --size <spec>        Params to tune for, as WxH:min_rooms,max_rooms,breaches,portals,"
+                  << " can be repeated" << std::endl
+                  << "  --seeds <n>          Seeds per size (default 4)" << std::endl
+                  << "  --candidates <n>     Configs to race, including the base config (default 16)" << std::endl
+                  << "  --models <n>         Levels per solve, or 0 to solve until the optimum is proven"
+                  << " (default 1)" << std::endl
+                  << "  --threads <n>        Solver threads (default 1)" << std::endl
+                  << "  --timeout <s>        Time limit per solve, timeouts score double (default 10)" << std::endl
+                  << "  --rng-seed <n>       Seed for sampling candidate configs (default 1)" << std::endl;
+    }
+
+    bool parse_options(int argc, char** argv, Options& options)
+    {
+        for (auto i = 1; i < argc; ++i)
+        {
+            const auto has_value = i + 1 < argc;
+            if (std::strcmp(argv[i], "--base") == 0 && has_value)
+            {
+                options.base_path = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--out") == 0 && has_value)
+            {
+                options.out_path = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--size") == 0 && has_value)
+            {
+                Instance size{};
+                if (!parse_size(argv[++i], size))
+                {
+                    return false;
+                }
+                options.sizes.push_back(size);
+            }
+            else if (std::strcmp(argv[i], "--seeds") == 0 && has_value)
+            {
+                options.num_seeds = std::max(std::stoul(argv[++i]), 1UL);
+            }
+            else if (std::strcmp(argv[i], "--candidates") == 0 && has_value)
+            {
+                options.num_candidates = std::max(std::stoul(argv[++i]), 1UL);
+            }
+            else if (std::strcmp(argv[i], "--models") == 0 && has_value)
+            {
+                options.max_num_levels = std::stoul(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--threads") == 0 && has_value)
+            {
+                options.num_threads = std::max(std::stoul(argv[++i]), 1UL);
+            }
+            else if (std::strcmp(argv[i], "--timeout") == 0 && has_value)
+            {
+                options.timeout_s = std::stod(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--rng-seed") == 0 && has_value)
+            {
+                options.rng_seed = std::stoul(argv[++i]);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (options.sizes.empty())
+        {
+            // Small, default and large maps
+            options.sizes = {
+                    {10, 10, 1, 6, 1, 1, 0},
+                    {16, 16, 2, 8, 3, 1, 0},
+                    {24, 16, 3, 12, 2, 2, 0},
+            };
+        }
+        return true;
+    }
+
+    /// Solve one instance with a candidate, returning the solve time, or double the timeout if it did not finish
+    double run(const Candidate& candidate, const Instance& instance, const Options& options)
+    {
+        LevelGenerator gen{
+                options.max_num_levels, instance.width, instance.height, instance.min_rooms, instance.max_rooms,
+                instance.num_breaches, instance.num_portals, instance.seed, false, options.num_threads,
+                ParallelMode::Split, nullptr, candidate.path.c_str()
+        };
+
+        // Grounding cannot be cut short, so ground with an empty budget first, and only time out the search
+        gen.solve_for(0U);
+        gen.solve_for(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::duration<double>(options.timeout_s)));
+
+        const auto stats = gen.get_stats();
+        const auto finished = stats.optimality_proven
+                              || (options.max_num_levels > 0 && gen.get_num_levels() >= options.max_num_levels);
+        return finished && stats.solve_time < options.timeout_s ? stats.solve_time : 2.0 * options.timeout_s;
+    }
+}
+
+/// Tunes the solver configuration by racing candidate configs with successive halving. Every candidate is run on a
+/// few instances, then the slower half is dropped and the rest run on twice as many, until one is left. The winner
+/// is written out in the same format as configs/tuned.cfg, which is embedded in the library at build time.
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 1;
+    }
+
+    SolverConfig base;
+    {
+        std::ifstream base_file(options.base_path);
+        if (!base_file.is_open())
+        {
+            std::cerr << "Failed to open " << options.base_path << std::endl;
+            return 1;
+        }
+        base = parse_solver_config(base_file);
+    }
+
+    // Interleave sizes, so every round covers all of them
+    std::vector<Instance> instances;
+    for (auto seed = 1U; seed <= options.num_seeds; ++seed)
+    {
+        for (auto instance : options.sizes)
+        {
+            instance.seed = seed;
+            instances.push_back(instance);
+        }
+    }
+
+    // The base config is always a candidate, so the result can never be worse than it on the instances run
+    std::mt19937 rng(options.rng_seed);
+    std::vector<Candidate> candidates(options.num_candidates);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        auto& candidate = candidates[i];
+        candidate.config = base;
+        if (i > 0)
+        {
+            for (const auto& param : search_space)
+            {
+                if (std::bernoulli_distribution(0.5)(rng))
+                {
+                    std::uniform_int_distribution<size_t> pick(0, param.values.size() - 1);
+                    set_value(candidate.config, param.key, param.values[pick(rng)]);
+                }
+            }
+        }
+
+        candidate.path = std::string(options.out_path) + ".candidate-" + std::to_string(i);
+        std::ofstream file(candidate.path);
+        write_solver_config(file, candidate.config);
+    }
+
+    std::vector<Candidate*> alive;
+    for (auto& candidate : candidates)
+    {
+        alive.push_back(&candidate);
+    }
+
+    size_t num_run = 0;
+    auto budget = std::min(options.sizes.size(), instances.size());
+    while (true)
+    {
+        std::cerr << "Racing " << alive.size() << " configs on " << budget << " instances" << std::endl;
+        for (auto* candidate : alive)
+        {
+            for (auto i = num_run; i < budget && !candidate->failed; ++i)
+            {
+                try
+                {
+                    candidate->total_score += run(*candidate, instances[i], options);
+                    ++candidate->num_runs;
+                }
+                catch (const std::exception& e)
+                {
+                    // Some combinations of options are rejected by clingo
+                    std::cerr << "  config " << candidate->path << " failed: " << e.what() << std::endl;
+                    candidate->failed = true;
+                }
+            }
+        }
+        num_run = budget;
+
+        std::stable_sort(alive.begin(), alive.end(), [](const Candidate* left, const Candidate* right)
+        {
+            return left->mean_score() < right->mean_score();
+        });
+        if (alive.size() == 1 || num_run == instances.size())
+        {
+            break;
+        }
+        alive.resize((alive.size() + 1) / 2);
+        budget = std::min(budget * 2, instances.size());
+    }
+
+    const auto& winner = *alive.front();
+    std::cerr << "Best mean time: " << winner.mean_score() << " s, base config: "
+              << candidates.front().mean_score() << " s over " << candidates.front().num_runs << " instances"
+              << std::endl;
+
+    std::ofstream out(options.out_path);
+    out << "# Solver configuration for the level generator, embedded at build time." << std::endl
+        << "# Each line sets a clingo configuration key, as \"key = value\". Keys under \"solver.\" and the base "
+        << "configuration only" << std::endl
+        << "# apply to split mode, as in compete mode each thread takes its configuration from the portfolio instead."
+        << std::endl
+        << "#" << std::endl
+        << "# Generated by level-gen-tune, over " << instances.size() << " instances, with a mean solve time of "
+        << winner.mean_score() << " s" << std::endl
+        << std::endl;
+    write_solver_config(out, winner.config);
+
+    for (const auto& candidate : candidates)
+    {
+        std::remove(candidate.path.c_str());
+    }
+
+    std::cerr << "Wrote " << options.out_path << " - copy it to configs/tuned.cfg to embed it in the library"
+              << std::endl;
+    return 0;
+}
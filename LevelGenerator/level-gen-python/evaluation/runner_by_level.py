@@ -28,6 +28,7 @@ piclasp_args = ("--backprop --learn-explicit --no-gamma --eq=0 --sat-prepro=0 --
                 " --save-progress=115 --score-other=no --score-res=multiset --sign-def=pos --update-lbd=0")
 
 this_dir = os.path.dirname(__file__)
+inputs_path = os.path.abspath(os.path.join(this_dir, 'inputs.lp'))
 
 ship_square = re.compile(r'ship\((\d+),(\d+)\)')
 breach = re.compile(r'alien_breach\((\d+),(\d+),(\d+),(\d+),(\d+),(\d+)\)')
@@ -90,14 +91,19 @@ for param_set in level_params:
         width = np.random.randint(16, 19)
         height = np.random.randint(7, 9) * 2
 
+        # The room, breach and portal counts are externals in ship.lp, rather than constants, so are set by facts
+        with open(inputs_path, 'w') as inputs:
+            inputs.write(f'min_rooms({min_rooms}). max_rooms({max_rooms}).\n')
+            inputs.write(f'num_breaches({param_set[breaches_key]}). num_portals({param_set[portals_key]}).\n')
+
         args = (
             f"{os.path.join(this_dir, '..', 'clingo', 'clingo.exe')}"
             f" {num_models} -c width={width} -c height={height}"
-            f" -c num_breaches={param_set[breaches_key]} -c num_portals={param_set[portals_key]}"
-            f" -c min_rooms={min_rooms} -c max_rooms={max_rooms}"
             f" -t 4,split --rand-freq=1.0 --seed={seed} --configuration=jumpy {piclasp_args}"
             f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'ship.lp'))}"
             f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'connections.lp'))}"
+            f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'geometry.lp'))}"
+            f" {inputs_path}"
         )
 
         start = time()
@@ -23,14 +23,21 @@ piclasp_args = (
 )
 
 this_dir = os.path.dirname(__file__)
+inputs_path = os.path.abspath(os.path.join(this_dir, 'inputs.lp'))
+
+# The room, breach and portal counts are externals in ship.lp, rather than constants, so are set by facts
+with open(inputs_path, 'w') as inputs:
+    inputs.write(f'min_rooms({min_rooms}). max_rooms({max_rooms}).\n')
+    inputs.write(f'num_breaches({num_breaches}). num_portals({num_portals}).\n')
 
 args = (
     f"{os.path.join(this_dir, '..', 'clingo', 'clingo.exe')}"
-    f" {num_models} -c width={width} -c height={height} -c num_breaches={num_breaches}"
-    f" -c min_rooms={min_rooms} -c max_rooms={max_rooms} -c num_portals={num_portals}"
+    f" {num_models} -c width={width} -c height={height}"
     f" -t 4,split --rand-freq=1.0 --seed={seed} --configuration=jumpy {piclasp_args}"
     f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'ship.lp'))}"
     f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'connections.lp'))}"
+    f" {os.path.abspath(os.path.join(this_dir, '..', '..', 'level-gen-cpp', 'programs', 'geometry.lp'))}"
+    f" {inputs_path}"
 )
 
 start = time()